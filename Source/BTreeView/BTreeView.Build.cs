@@ -15,6 +15,7 @@ public class BTreeView : ModuleRules
         if (Target.bBuildEditor)
         {
             PublicDependencyModuleNames.Add("EditorStyle");
+            PrivateDependencyModuleNames.Add("DirectoryWatcher");
         }
 	}
 }
\ No newline at end of file
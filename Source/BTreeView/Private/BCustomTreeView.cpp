@@ -1,14 +1,56 @@
 /// MIT License, Copyright Burak Kara, burak@burak.io, https://en.wikipedia.org/wiki/MIT_License
 
 #include "BCustomTreeView.h"
+#include "BTreeChildProvider.h"
+#include "BDirectoryTreeSource.h"
+#include "BTreeView.h"
+#include "BTreeFilter.h"
+#include "BTreeNameIndex.h"
+#include "Async/ParallelFor.h"
+#include "Containers/Ticker.h"
+#include "Misc/Paths.h"
 
 #define LOCTEXT_NAMESPACE "UMG"
 
+/** Flags stored in tree snapshots */
+static const uint32 SnapshotStableNodeIDs = 1 << 0;
+
+/** @return The node store flags of a new node */
+static uint8 GetStoreFlags(const FBTreeNode& Node)
+{
+	return Node.HasLazyChildren ? EBTreeNodeFlags::LazyChildren : EBTreeNodeFlags::None;
+}
+
 UBCustomTreeView::UBCustomTreeView()
 {
 	bIsVariable = false;
 	ExpanderVisibility = true;
 	RowDefaultPadding = FMargin(4);
+	RowContentPoolSize = 64;
+	RowContentPoolHits = 0;
+	RowContentPoolMisses = 0;
+	UseStableNodeIDs = false;
+	UseLegacyNodeEvents = false;
+	AsyncBuildBudgetMs = 4.0f;
+	TreeBuildCursor = 0;
+	TreeBuildEnd = 0;
+	TreeBuildNumUsableNodes = 0;
+	TreeBuildStartTime = 0.0;
+	bExternalTree = false;
+	bDirectoryScanComplete = false;
+	ChildProvider = nullptr;
+	LazyChildrenLifetime = 60.0f;
+	bFilterExtraStrings = false;
+	bFilterStale = false;
+	IndexNodeNames = false;
+	SortMode = EBTreeSortMode::None;
+	SortExtraStringIndex = -1;
+	SortDescending = false;
+	MultiSelect = false;
+	TreeColumnWidth = 200.0f;
+	AllowDragAndDrop = false;
+	bAggregatesPending = false;
+	NodeStore = MakeShared<FBTreeNodeStore>();
 }
 
 #if WITH_EDITOR
@@ -16,6 +58,13 @@ const FText UBCustomTreeView::GetPaletteCategory()
 {
 	return LOCTEXT("Views", "Views");
 }
+
+void UBCustomTreeView::PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent)
+{
+	Super::PostEditChangeProperty(PropertyChangedEvent);
+	RefreshRowContentRules();
+	RefreshAggregates();
+}
 #endif
 
 void UBCustomTreeView::ReleaseSlateResources(bool bReleaseChildren)
@@ -23,12 +72,28 @@ void UBCustomTreeView::ReleaseSlateResources(bool bReleaseChildren)
 	Super::ReleaseSlateResources(bReleaseChildren);
 
 	TreeViewWidget.Reset();
+	RowContentPools.Empty();
+}
+
+void UBCustomTreeView::BeginDestroy()
+{
+	StopTreeBuild();
+	ClearFilter();
+	Super::BeginDestroy();
 }
 
 TSharedRef<SWidget> UBCustomTreeView::RebuildWidget()
  {
-	 TreeViewWidget = SNew(SBCustomTreeView).TWidget(this).TStyle(&TreeViewStyle).ExpandedArrowStyle(&ArrowStyle).ExpanderVisibility(ExpanderVisibility);
-	 CreateTree();
+	 TreeViewWidget = SNew(SBCustomTreeView).TWidget(this).TStyle(&TreeViewStyle).ExpandedArrowStyle(&ArrowStyle).ExpanderVisibility(ExpanderVisibility).NodeStore(NodeStore);
+	 TreeViewWidget->SetFilter(FilterResult);
+	 if (IsBuildingTree() || bExternalTree)
+	 {
+		 TreeViewWidget->RebuildTree();
+	 }
+	 else
+	 {
+		 CreateTree();
+	 }
 	 return TreeViewWidget.ToSharedRef();
  }
 
@@ -41,134 +106,1918 @@ void UBCustomTreeView::EnsureWidgetValidity()
 	ensure(TreeViewWidget.IsValid());
 }
 
-int32 UBCustomTreeView::GetRootIndex(int32 NodeIndex)
+int32 UBCustomTreeView::GetRootIndex(int32 NodeIndex) const
+{
+	return NodeStore->GetRoot(NodeIndex);
+}
+
+int64 UBCustomTreeView::GetParentNodeID(int32 NodeIndex) const
+{
+	const int32 ParentIndex = NodeStore->GetParent(NodeIndex);
+	if (ParentIndex == INDEX_NONE)
+	{
+		return 0;
+	}
+	return UseStableNodeIDs ? NodeStore->GetKey(ParentIndex) : NodeStore->GetKey(ParentIndex) + 1;
+}
+
+bool UBCustomTreeView::FindParentIndex(int64 ParentID, int32& OutParentIndex) const
+{
+	OutParentIndex = INDEX_NONE;
+	if (ParentID == 0)
+	{
+		return true;
+	}
+	if (!UseStableNodeIDs && ParentID < 0)
+	{
+		return false;
+	}
+
+	OutParentIndex = NodeStore->FindNode(UseStableNodeIDs ? ParentID : ParentID - 1);
+	return OutParentIndex != INDEX_NONE;
+}
+
+FBTreeNode* UBCustomTreeView::FindTreeNodeEntry(int64 NodeId)
+{
+	if (!UseStableNodeIDs)
+	{
+		return NodeId >= 0 && NodeId < TreeNodes.Num() && TreeNodes[(int32)NodeId].ParentID >= 0 ? &TreeNodes[(int32)NodeId] : nullptr;
+	}
+
+	const int32* Position = TreeNodePositions.Find(NodeId);
+	return Position ? &TreeNodes[*Position] : nullptr;
+}
+
+void UBCustomTreeView::RemoveTreeNodeEntry(int64 NodeId)
 {
-	if (TreeNodes[NodeIndex].ParentID == 0)
+	if (!UseStableNodeIDs)
+	{
+		// Positions are NodeIDs, the entry stays in place and is only marked as removed.
+		if (NodeId >= 0 && NodeId < TreeNodes.Num())
+		{
+			TreeNodes[(int32)NodeId].ParentID = -1;
+		}
+		return;
+	}
+
+	int32 Position;
+	if (!TreeNodePositions.RemoveAndCopyValue(NodeId, Position))
+	{
+		return;
+	}
+
+	TreeNodes.RemoveAtSwap(Position, 1, false);
+	if (TreeNodes.IsValidIndex(Position))
 	{
-		return NodeIndex;
+		int32* MovedPosition = TreeNodePositions.Find(TreeNodes[Position].NodeID);
+		if (MovedPosition && *MovedPosition == TreeNodes.Num())
+		{
+			*MovedPosition = Position;
+		}
 	}
-	return GetRootIndex(TreeNodes[NodeIndex].ParentID-1);
 }
-void UBCustomTreeView::ExpandTreeItem(int32 NodeId)
+
+void UBCustomTreeView::ExpandTreeItem(int64 NodeId)
 {
 	EnsureWidgetValidity();
-	if (TempStructure.Num() > NodeId)
+	const int32 NodeIndex = NodeStore->FindNode(NodeId);
+	if (NodeIndex != INDEX_NONE)
 	{
-		TreeViewWidget->ExpandTreeItem(TempStructure[NodeId]);
+		TreeViewWidget->ExpandTreeItem(TreeViewWidget->GetNodeHandle(NodeIndex));
 	}
 }
 
-void UBCustomTreeView::SelectTreeItem(int32 NodeId)
+void UBCustomTreeView::SelectTreeItem(int64 NodeId)
 {
 	EnsureWidgetValidity();
-	if (TempStructure.Num() > NodeId)
+	const int32 NodeIndex = NodeStore->FindNode(NodeId);
+	if (NodeIndex != INDEX_NONE)
 	{
 		TreeViewWidget->SetOnMouseButtonDown(FPointerEventHandler());
-		TreeViewWidget->SelectDirectory(TempStructure[NodeId]);
+		TreeViewWidget->SelectDirectory(TreeViewWidget->GetNodeHandle(NodeIndex));
+	}
+}
+
+void UBCustomTreeView::CollapseTreeItem(int64 NodeId)
+{
+	EnsureWidgetValidity();
+	const int32 NodeIndex = NodeStore->FindNode(NodeId);
+	if (NodeIndex != INDEX_NONE)
+	{
+		TreeViewWidget->CollapseTreeItem(TreeViewWidget->GetNodeHandle(NodeIndex));
+	}
+}
+
+void UBCustomTreeView::ToggleNodeExpansion(int64 NodeId)
+{
+	EnsureWidgetValidity();
+	const int32 NodeIndex = NodeStore->FindNode(NodeId);
+	if (NodeIndex != INDEX_NONE)
+	{
+		TreeViewWidget->ToggleNodeExpansion(TreeViewWidget->GetNodeHandle(NodeIndex));
+	}
+}
+
+void UBCustomTreeView::ExpandAll()
+{
+	EnsureWidgetValidity();
+	TreeViewWidget->ExpandAll();
+}
+
+void UBCustomTreeView::CollapseAll()
+{
+	EnsureWidgetValidity();
+	TreeViewWidget->CollapseAll();
+}
+
+void UBCustomTreeView::ExpandToDepth(int32 Depth)
+{
+	EnsureWidgetValidity();
+	TreeViewWidget->ExpandToDepth(Depth);
+}
+
+bool UBCustomTreeView::ExpandPath(int64 NodeId)
+{
+	EnsureWidgetValidity();
+	const int32 NodeIndex = NodeStore->FindNode(NodeId);
+	if (NodeIndex == INDEX_NONE)
+	{
+		return false;
+	}
+
+	TreeViewWidget->ExpandPath(NodeIndex);
+	return true;
+}
+
+void UBCustomTreeView::SetExpansion(const TArray<int64>& NodeIds, bool bExpanded)
+{
+	EnsureWidgetValidity();
+	TArray<int32> NodeIndices;
+	NodeIndices.Reserve(NodeIds.Num());
+	for (int64 NodeId : NodeIds)
+	{
+		const int32 NodeIndex = NodeStore->FindNode(NodeId);
+		if (NodeIndex != INDEX_NONE)
+		{
+			NodeIndices.Add(NodeIndex);
+		}
+	}
+	TreeViewWidget->SetNodesExpansion(NodeIndices, bExpanded);
+}
+
+bool UBCustomTreeView::ScrollToNode(int64 NodeId)
+{
+	EnsureWidgetValidity();
+	const int32 NodeIndex = NodeStore->FindNode(NodeId);
+	if (NodeIndex == INDEX_NONE)
+	{
+		return false;
 	}
+
+	TreeViewWidget->ScrollToNode(NodeIndex);
+	return TreeViewWidget->GetVisibleIndex(NodeIndex) != INDEX_NONE;
+}
+
+int32 UBCustomTreeView::GetVisibleIndex(int64 NodeId) const
+{
+	const int32 NodeIndex = NodeStore->FindNode(NodeId);
+	return NodeIndex != INDEX_NONE && TreeViewWidget.IsValid() ? TreeViewWidget->GetVisibleIndex(NodeIndex) : INDEX_NONE;
 }
 
-void UBCustomTreeView::CollapseTreeItem(int32 NodeId)
+bool UBCustomTreeView::NodeAtVisibleIndex(int32 VisibleIndex, FBTreeNodeHandle& Node) const
+{
+	const int32 NodeIndex = TreeViewWidget.IsValid() ? TreeViewWidget->GetNodeAtVisibleIndex(VisibleIndex) : INDEX_NONE;
+	Node = NodeIndex != INDEX_NONE ? MakeNodeHandle(NodeIndex) : FBTreeNodeHandle();
+	return NodeIndex != INDEX_NONE;
+}
+
+int32 UBCustomTreeView::GetNumVisibleRows() const
+{
+	return TreeViewWidget.IsValid() ? TreeViewWidget->GetNumVisibleRows() : 0;
+}
+
+void UBCustomTreeView::SelectAll()
+{
+	EnsureWidgetValidity();
+	TreeViewWidget->SelectAll();
+}
+
+void UBCustomTreeView::ClearSelection()
+{
+	EnsureWidgetValidity();
+	TreeViewWidget->ClearSelection();
+}
+
+void UBCustomTreeView::SetSelection(const TArray<int64>& NodeIds, bool bSelected)
 {
 	EnsureWidgetValidity();
-	if (TempStructure.Num() > NodeId)
+	TArray<int32> NodeIndices;
+	NodeIndices.Reserve(NodeIds.Num());
+	for (int64 NodeId : NodeIds)
 	{
-		TreeViewWidget->CollapseTreeItem(TempStructure[NodeId]);
+		const int32 NodeIndex = NodeStore->FindNode(NodeId);
+		if (NodeIndex != INDEX_NONE)
+		{
+			NodeIndices.Add(NodeIndex);
+		}
 	}
+	TreeViewWidget->SetNodesSelection(NodeIndices, bSelected);
 }
 
-void UBCustomTreeView::ToggleNodeExpansion(int32 NodeId)
+void UBCustomTreeView::SelectSubtree(int64 NodeId, bool bSelected)
 {
 	EnsureWidgetValidity();
-	if (TempStructure.Num() > NodeId)
+	const int32 NodeIndex = NodeStore->FindNode(NodeId);
+	if (NodeIndex != INDEX_NONE)
 	{
-		TreeViewWidget->ToggleNodeExpansion(TempStructure[NodeId]);
+		TreeViewWidget->SetSubtreeSelection(NodeIndex, bSelected);
+	}
+}
+
+bool UBCustomTreeView::IsNodeSelected(int64 NodeId) const
+{
+	const int32 NodeIndex = NodeStore->FindNode(NodeId);
+	return TreeViewWidget.IsValid() && NodeIndex != INDEX_NONE && TreeViewWidget->IsNodeSelected(NodeIndex);
+}
+
+int32 UBCustomTreeView::GetNumSelectedNodes() const
+{
+	return TreeViewWidget.IsValid() ? TreeViewWidget->GetNumSelectedNodes() : 0;
+}
+
+void UBCustomTreeView::GetSelectedNodeIDs(TArray<int64>& NodeIds) const
+{
+	NodeIds.Reset();
+	if (!TreeViewWidget.IsValid())
+	{
+		return;
+	}
+	NodeIds.Reserve(TreeViewWidget->GetNumSelectedNodes());
+	for (TConstSetBitIterator<> It(TreeViewWidget->GetSelectedNodes()); It; ++It)
+	{
+		if (NodeStore->IsValidNode(It.GetIndex()))
+		{
+			NodeIds.Add(NodeStore->GetKey(It.GetIndex()));
+		}
 	}
 }
 
 void UBCustomTreeView::CreateTree()
 {
-	TreeStructure.Empty();
-	TempStructure.Empty();
-	for (int i = 0; i < TreeNodes.Num(); i++)
+	// Markers for the parent position of a node, INDEX_NONE being a root.
+	static const int32 MissingParent = -2;
+
+	StopTreeBuild();
+	WaitForFilter();
+	bExternalTree = false;
+
+	const double StartTime = FPlatformTime::Seconds();
+	const int32 NumTreeNodes = TreeNodes.Num();
+	BuildReport = FBTreeBuildReport();
+
+	// Assign or index the NodeIDs. Legacy nodes with a negative ParentID were removed and are skipped.
+	TBitArray<> UsableNodes(true, NumTreeNodes);
+	int32 NumUsableNodes = 0;
+	int32 NumChars = 0;
+	int32 NumExtraStrings = 0;
+	TreeNodePositions.Reset();
+	if (UseStableNodeIDs)
+	{
+		TreeNodePositions.Reserve(NumTreeNodes);
+	}
+	for (int32 i = 0; i < NumTreeNodes; i++)
 	{
-		TreeNodes[i].NodeID = i;
-		if (TreeNodes[i].ParentID == 0)
+		FBTreeNode& Node = TreeNodes[i];
+		if (!UseStableNodeIDs)
+		{
+			Node.NodeID = i;
+			UsableNodes[i] = Node.ParentID >= 0;
+		}
+		else if (Node.NodeID == 0 || TreeNodePositions.Contains(Node.NodeID))
 		{
-			TSharedRef<BCustomTreeNode> RootDir = MakeShareable(new BCustomTreeNode(NULL, TreeNodes[i].NodeName, TreeNodes[i].NodeName , TreeNodes[i].NodeID , 0 , TreeNodes[i].NodePadding , TreeNodes[i].ExtraStrings));
-			TreeStructure.Add(RootDir);
-			TempStructure.Add(RootDir);
+			BuildReport.DuplicateNodeIDs.Add(Node.NodeID);
+			UsableNodes[i] = false;
 		}
 		else
 		{
-			if (TempStructure.Num() >= TreeNodes[i].ParentID)
+			TreeNodePositions.Add(Node.NodeID, i);
+		}
+
+		if (!UsableNodes[i])
+		{
+			continue;
+		}
+		NumUsableNodes++;
+		NumChars += Node.NodeName.Len() + 1;
+		NumExtraStrings += Node.ExtraStrings.Num();
+		for (const FString& ExtraString : Node.ExtraStrings)
+		{
+			NumChars += ExtraString.Len() + 1;
+		}
+	}
+
+	// Resolve the position of every parent, the lookups being independent of each other.
+	TArray<int32> ParentPositions;
+	ParentPositions.SetNumUninitialized(NumTreeNodes);
+	ParallelFor(NumTreeNodes, [this, NumTreeNodes, &UsableNodes, &ParentPositions](int32 i)
+	{
+		const int64 ParentID = TreeNodes[i].ParentID;
+		int32 ParentPosition = MissingParent;
+		if (!UsableNodes[i] || ParentID == 0)
+		{
+			ParentPosition = INDEX_NONE;
+		}
+		else if (UseStableNodeIDs)
+		{
+			const int32* Position = TreeNodePositions.Find(ParentID);
+			if (Position)
+			{
+				ParentPosition = *Position;
+			}
+		}
+		else if (ParentID > 0 && ParentID <= NumTreeNodes && UsableNodes[(int32)ParentID - 1])
+		{
+			ParentPosition = (int32)ParentID - 1;
+		}
+		ParentPositions[i] = ParentPosition;
+	});
+
+	// Bucket the children by parent, keeping their order in TreeNodes. Bucket 0 holds the roots, bucket p + 1 the children of position p.
+	TArray<int32> BucketStarts;
+	BucketStarts.SetNumZeroed(NumTreeNodes + 2);
+	for (int32 i = 0; i < NumTreeNodes; i++)
+	{
+		if (UsableNodes[i] && ParentPositions[i] != MissingParent)
+		{
+			BucketStarts[ParentPositions[i] + 2]++;
+		}
+	}
+	for (int32 Bucket = 1; Bucket < BucketStarts.Num(); Bucket++)
+	{
+		BucketStarts[Bucket] += BucketStarts[Bucket - 1];
+	}
+
+	TArray<int32> BucketedNodes;
+	BucketedNodes.SetNumUninitialized(BucketStarts.Last());
+	TArray<int32> BucketCursors(BucketStarts);
+	for (int32 i = 0; i < NumTreeNodes; i++)
+	{
+		if (UsableNodes[i] && ParentPositions[i] != MissingParent)
+		{
+			BucketedNodes[BucketCursors[ParentPositions[i] + 1]++] = i;
+		}
+	}
+
+	// Link breadth first from the roots, so every parent is in the store before its children.
+	if (TreeViewWidget.IsValid())
+	{
+		TreeViewWidget->SaveViewState();
+	}
+	NodeStore->Reset(NumTreeNodes, NumChars, NumExtraStrings);
+	NodeStore->SetNameIndexEnabled(IndexNodeNames);
+	RefreshRowContentRules();
+	RefreshAggregates();
+	CollapsedLazyNodes.Reset();
+	TArray<int32> StoreIndices;
+	StoreIndices.SetNumUninitialized(NumTreeNodes);
+	TBitArray<> PlacedNodes(false, NumTreeNodes);
+	TArray<int32> PendingNodes;
+	PendingNodes.Reserve(BucketedNodes.Num());
+	PendingNodes.Append(BucketedNodes.GetData() + BucketStarts[0], BucketStarts[1] - BucketStarts[0]);
+	for (int32 Head = 0; Head < PendingNodes.Num(); Head++)
+	{
+		const int32 Position = PendingNodes[Head];
+		const int32 ParentPosition = ParentPositions[Position];
+		const FBTreeNode& Node = TreeNodes[Position];
+
+		StoreIndices[Position] = NodeStore->AddNode(Node.NodeID, ParentPosition == INDEX_NONE ? INDEX_NONE : StoreIndices[ParentPosition], Node.NodeName, Node.NodePadding, Node.ExtraStrings, GetStoreFlags(Node));
+		PlacedNodes[Position] = true;
+
+		const int32 Bucket = Position + 1;
+		PendingNodes.Append(BucketedNodes.GetData() + BucketStarts[Bucket], BucketStarts[Bucket + 1] - BucketStarts[Bucket]);
+	}
+	ApplySort();
+
+	BuildReport.NumNodes = NodeStore->NumNodes();
+	if (BuildReport.NumNodes < NumUsableNodes)
+	{
+		// Whatever hangs below an orphan is left out with it, the remaining unplaced nodes are in or below a cycle.
+		PendingNodes.Reset();
+		for (int32 i = 0; i < NumTreeNodes; i++)
+		{
+			if (UsableNodes[i] && ParentPositions[i] == MissingParent)
+			{
+				BuildReport.OrphanNodeIDs.Add(TreeNodes[i].NodeID);
+				PendingNodes.Add(i);
+			}
+		}
+		for (int32 Head = 0; Head < PendingNodes.Num(); Head++)
+		{
+			const int32 Position = PendingNodes[Head];
+			PlacedNodes[Position] = true;
+
+			const int32 Bucket = Position + 1;
+			PendingNodes.Append(BucketedNodes.GetData() + BucketStarts[Bucket], BucketStarts[Bucket + 1] - BucketStarts[Bucket]);
+		}
+		for (int32 i = 0; i < NumTreeNodes; i++)
+		{
+			if (UsableNodes[i] && !PlacedNodes[i])
 			{
-				TreeNodePtr Parent = TempStructure[TreeNodes[i].ParentID - 1];
-				
-				TreeNodePtr Child = MakeShareable(new BCustomTreeNode(Parent, TreeNodes[i].NodeName, TreeNodes[i].NodeName, TreeNodes[i].NodeID , TreeNodes[i].ParentID , TreeNodes[i].NodePadding, TreeNodes[i].ExtraStrings));
-				Parent->AddSubDirectory(Child);
-				TempStructure.Add(Child);
+				BuildReport.CycleNodeIDs.Add(TreeNodes[i].NodeID);
 			}
 		}
+
+		BuildReport.NumUnplacedNodes = PendingNodes.Num() + BuildReport.CycleNodeIDs.Num();
 	}
+	BuildReport.BuildTimeMs = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+	LogBuildReport();
 
 	EnsureWidgetValidity();
-	TreeViewWidget->RefreshTree(TreeStructure);
+	TreeViewWidget->RebuildTree();
+	TreeViewWidget->RestoreViewState(true);
+	RefreshFilter();
 }
 
-void UBCustomTreeView::HandleOnGenerateRow(TreeNodePtr Item, class UUserWidget* RowWidget, TArray<TreeNodePtr> Children)
- {
-	 if (Item.IsValid())
-	 {
-		 FBTreeNode Node;
-		 Node.NodeID = Item->GetNodeID();
-		 Node.NodeName = Item->GetDisplayName();
-		 Node.ParentID = Item->GetParentID();
-		 Node.ExtraStrings = Item->GetExtraStrings();
-		 TArray<FBTreeNode> NodeChildren;
-
-		 for (int i = 0; i < Children.Num(); i++)
-		 {
-			 FBTreeNode Childnode;
-			 Childnode.NodeID = Item->GetNodeID();
-			 Childnode.NodeName = Children[i]->GetDisplayName();
-			 Childnode.ParentID = Children[i]->GetParentID();
-			 Childnode.ExtraStrings = Children[i]->GetExtraStrings();
-			 NodeChildren.Add(Childnode);
-		 }
-
-		 OnGenerateRow.Broadcast(Node, RowWidget, NodeChildren);
-	 }
- }
+void UBCustomTreeView::LogBuildReport() const
+{
+	if (BuildReport.NumUnplacedNodes > 0)
+	{
+		UE_LOG(LogBTreeView, Warning, TEXT("%s: %d tree nodes left out, %d orphans and %d nodes in cycles"), *GetName(), BuildReport.NumUnplacedNodes, BuildReport.OrphanNodeIDs.Num(), BuildReport.CycleNodeIDs.Num());
+	}
+	if (BuildReport.DuplicateNodeIDs.Num() > 0)
+	{
+		UE_LOG(LogBTreeView, Warning, TEXT("%s: %d tree nodes skipped for reserved or repeated NodeIDs"), *GetName(), BuildReport.DuplicateNodeIDs.Num());
+	}
+}
 
-void UBCustomTreeView::HandleOnSelectionChanged(TreeNodePtr Item, class UUserWidget* RowWidget)
+void UBCustomTreeView::CreateTreeAsync()
 {
-	if (Item.IsValid())
+	StopTreeBuild();
+	WaitForFilter();
+	bExternalTree = false;
+
+	TreeBuildStartTime = FPlatformTime::Seconds();
+	TreeBuildCursor = 0;
+	TreeBuildEnd = TreeNodes.Num();
+	TreeBuildNumUsableNodes = 0;
+	BuildReport = FBTreeBuildReport();
+	if (TreeViewWidget.IsValid())
 	{
-		FBTreeNode node;
-		node.NodeID = Item->GetNodeID();
-		node.NodeName = Item->GetDisplayName();
-		node.ParentID = Item->GetParentID();
-		node.ExtraStrings = Item->GetExtraStrings();
-		OnSelectionChanged.Broadcast(node , RowWidget);
+		TreeViewWidget->SaveViewState();
 	}
+	NodeStore->Reset(TreeBuildEnd);
+	NodeStore->SetNameIndexEnabled(IndexNodeNames);
+	ApplySort();
+	RefreshRowContentRules();
+	RefreshAggregates();
+	CollapsedLazyNodes.Reset();
+	TreeNodePositions.Reset();
+	TreeBuildTickerHandle = FTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateUObject(this, &UBCustomTreeView::TickTreeBuild));
+
+	EnsureWidgetValidity();
+	TreeViewWidget->RebuildTree();
+	InvalidateFilter();
 }
 
-void UBCustomTreeView::HandleOnSelectionLost()
+bool UBCustomTreeView::IsBuildingTree() const
 {
-	OnSelectionLost.Broadcast();
+	return TreeBuildTickerHandle.IsValid();
 }
 
-void UBCustomTreeView::HandleOnExpansionChanged(TreeNodePtr Item, class UUserWidget* RowWidget, bool ExpansionState)
+void UBCustomTreeView::CompleteTreeBuild()
+{
+	if (IsBuildingTree())
+	{
+		FTicker::GetCoreTicker().RemoveTicker(TreeBuildTickerHandle);
+		WaitForFilter();
+		for (; TreeBuildCursor < TreeBuildEnd; TreeBuildCursor++)
+		{
+			BuildTreeNode(TreeBuildCursor);
+		}
+		SortUnsortedNodes();
+		bAggregatesPending = true;
+		FinishTreeBuild();
+	}
+}
+
+void UBCustomTreeView::StopTreeBuild()
+{
+	if (IsBuildingTree())
+	{
+		FTicker::GetCoreTicker().RemoveTicker(TreeBuildTickerHandle);
+		TreeBuildTickerHandle.Reset();
+	}
+	PendingTreeNodes.Empty();
+	UnsortedNodes.Reset();
+
+	if (DirectorySourceTickerHandle.IsValid())
+	{
+		FTicker::GetCoreTicker().RemoveTicker(DirectorySourceTickerHandle);
+		DirectorySourceTickerHandle.Reset();
+	}
+	DirectorySource.Reset();
+}
+
+void UBCustomTreeView::CreateTreeFromDirectory(const FString& RootPath, bool bIncludeFiles, bool bWatchChanges)
+{
+	StopTreeBuild();
+	WaitForFilter();
+	EnsureWidgetValidity();
+
+	DirectorySource = MakeShared<FBDirectoryTreeSource>(RootPath, bIncludeFiles);
+	const FString& NormalizedRootPath = DirectorySource->GetRootPath();
+
+	TreeBuildStartTime = FPlatformTime::Seconds();
+	BuildReport = FBTreeBuildReport();
+	bExternalTree = true;
+	bDirectoryScanComplete = false;
+	UseStableNodeIDs = true;
+	TreeNodes.Empty();
+	TreeNodePositions.Empty();
+	CollapsedLazyNodes.Reset();
+	TreeViewWidget->SaveViewState();
+	NodeStore->Reset();
+	NodeStore->SetNameIndexEnabled(IndexNodeNames);
+	ApplySort();
+	RefreshRowContentRules();
+	RefreshAggregates();
+
+	const FString RootName = FPaths::GetCleanFilename(NormalizedRootPath);
+	const int32 RootIndex = NodeStore->AddNode(FBDirectoryTreeSource::MakeKey(NormalizedRootPath), INDEX_NONE, RootName.IsEmpty() ? NormalizedRootPath : RootName, FMargin(0), TArray<FString>());
+	NodeStore->SetDirectoryPath(RootIndex, NormalizedRootPath);
+
+	DirectorySource->Start(bWatchChanges);
+	DirectorySourceTickerHandle = FTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateUObject(this, &UBCustomTreeView::TickDirectorySource));
+
+	TreeViewWidget->RebuildTree();
+	InvalidateFilter();
+}
+
+bool UBCustomTreeView::TickDirectorySource(float DeltaTime)
 {
-	if (Item.IsValid())
+	const double EndTime = FPlatformTime::Seconds() + FMath::Max(AsyncBuildBudgetMs, 0.1f) / 1000.0;
+	const TArray<FString> NoExtraStrings;
+
+	// The entries are left for a later tick rather than waiting on the game thread for a filter still reading the store.
+	if (IsFilterRunning())
 	{
-		FBTreeNode node;
-		node.NodeID = Item->GetNodeID();
-		node.NodeName = Item->GetDisplayName();
-		node.ParentID = Item->GetParentID();
-		node.ExtraStrings = Item->GetExtraStrings();
-		OnExpansionChanged.Broadcast(node, RowWidget , ExpansionState);
+		return true;
+	}
+
+	// The initial scan adds too many nodes to update their ancestors one by one, the aggregates are built once read.
+	FBTreeAggregates* UpToDateAggregates = bDirectoryScanComplete ? GetUpToDateAggregates() : nullptr;
+
+	bool bChanged = false;
+	TArray<FBDirectoryEntry> Batch;
+	while (FPlatformTime::Seconds() < EndTime && DirectorySource->DequeueBatch(Batch))
+	{
+		bChanged = true;
+		for (const FBDirectoryEntry& Entry : Batch)
+		{
+			if (Entry.bRemoved)
+			{
+				const int32 NodeIndex = NodeStore->FindNode(Entry.Key);
+				if (NodeIndex != INDEX_NONE)
+				{
+					RemoveStoreSubtree(NodeIndex);
+				}
+			}
+			else
+			{
+				// Entries of a directory removed in the meantime have no parent left.
+				const int32 ParentIndex = NodeStore->FindNode(Entry.ParentKey);
+				const int32 NodeIndex = ParentIndex != INDEX_NONE ? NodeStore->AddNode(Entry.Key, ParentIndex, Entry.Name, FMargin(0), NoExtraStrings) : INDEX_NONE;
+				if (NodeIndex != INDEX_NONE && UpToDateAggregates)
+				{
+					UpToDateAggregates->AddNode(*NodeStore, NodeIndex);
+				}
+				if (NodeIndex != INDEX_NONE && Sort.IsValid())
+				{
+					UnsortedNodes.Add(NodeIndex);
+				}
+			}
+		}
+	}
+	SortUnsortedNodes();
+
+	if (bChanged && TreeViewWidget.IsValid())
+	{
+		TreeViewWidget->RefreshTree();
+		TreeViewWidget->RestoreViewState(false);
+	}
+	if (bChanged)
+	{
+		if (!bDirectoryScanComplete)
+		{
+			bAggregatesPending = true;
+		}
+		InvalidateFilter();
+	}
+
+	if (!bDirectoryScanComplete && DirectorySource->IsScanComplete())
+	{
+		bDirectoryScanComplete = true;
+		if (TreeViewWidget.IsValid())
+		{
+			TreeViewWidget->RestoreViewState(true);
+		}
+		BuildReport.NumNodes = NodeStore->NumNodes();
+		BuildReport.BuildTimeMs = (FPlatformTime::Seconds() - TreeBuildStartTime) * 1000.0;
+		OnTreeBuildProgress.Broadcast(1.0f, BuildReport.NumNodes);
+		OnTreeReady.Broadcast(BuildReport);
+
+		if (!DirectorySource->IsWatching())
+		{
+			// Returning false removes the ticker.
+			DirectorySourceTickerHandle.Reset();
+			return false;
+		}
+	}
+	else if (bChanged && !bDirectoryScanComplete)
+	{
+		OnTreeBuildProgress.Broadcast(0.0f, NodeStore->NumNodes());
+	}
+	return true;
+}
+
+bool UBCustomTreeView::TickTreeBuild(float DeltaTime)
+{
+	// Checking the clock for every node would cost more than building it.
+	static const int32 NodesPerClockCheck = 256;
+
+	// The slice is left for a later tick rather than waiting on the game thread for a filter still reading the store.
+	if (IsFilterRunning())
+	{
+		return true;
+	}
+
+	const double EndTime = FPlatformTime::Seconds() + FMath::Max(AsyncBuildBudgetMs, 0.1f) / 1000.0;
+	do
+	{
+		const int32 SliceEnd = FMath::Min(TreeBuildCursor + NodesPerClockCheck, TreeBuildEnd);
+		for (; TreeBuildCursor < SliceEnd; TreeBuildCursor++)
+		{
+			BuildTreeNode(TreeBuildCursor);
+		}
+	} while (TreeBuildCursor < TreeBuildEnd && FPlatformTime::Seconds() < EndTime);
+	SortUnsortedNodes();
+	bAggregatesPending = true;
+
+	if (TreeBuildCursor < TreeBuildEnd)
+	{
+		if (TreeViewWidget.IsValid())
+		{
+			TreeViewWidget->RefreshTree();
+			TreeViewWidget->RestoreViewState(false);
+		}
+		InvalidateFilter();
+		OnTreeBuildProgress.Broadcast((float)TreeBuildCursor / TreeBuildEnd, NodeStore->NumNodes());
+		return true;
+	}
+
+	// Returning false removes the ticker.
+	FinishTreeBuild();
+	return false;
+}
+
+void UBCustomTreeView::BuildTreeNode(int32 Position)
+{
+	FBTreeNode& Node = TreeNodes[Position];
+	if (!UseStableNodeIDs)
+	{
+		Node.NodeID = Position;
+		if (Node.ParentID < 0)
+		{
+			return;
+		}
+	}
+	else if (Node.NodeID == 0 || TreeNodePositions.Contains(Node.NodeID))
+	{
+		BuildReport.DuplicateNodeIDs.Add(Node.NodeID);
+		return;
+	}
+	else
+	{
+		TreeNodePositions.Add(Node.NodeID, Position);
+	}
+	TreeBuildNumUsableNodes++;
+
+	int32 ParentIndex;
+	if (!FindParentIndex(Node.ParentID, ParentIndex))
+	{
+		PendingTreeNodes.Add(UseStableNodeIDs ? Node.ParentID : Node.ParentID - 1, Position);
+		return;
+	}
+
+	// Add the node, then every node that was waiting for it. Waiting nodes are pushed in reverse so siblings keep their TreeNodes order.
+	TArray<TPair<int32, int32>, TInlineAllocator<16>> ReadyNodes;
+	ReadyNodes.Emplace(Position, ParentIndex);
+	TArray<int32> WaitingNodes;
+	while (ReadyNodes.Num() > 0)
+	{
+		const TPair<int32, int32> Ready = ReadyNodes.Pop(false);
+		const FBTreeNode& ReadyNode = TreeNodes[Ready.Key];
+		const int32 NodeIndex = NodeStore->AddNode(ReadyNode.NodeID, Ready.Value, ReadyNode.NodeName, ReadyNode.NodePadding, ReadyNode.ExtraStrings, GetStoreFlags(ReadyNode));
+		if (NodeIndex != INDEX_NONE && Sort.IsValid())
+		{
+			UnsortedNodes.Add(NodeIndex);
+		}
+
+		WaitingNodes.Reset();
+		PendingTreeNodes.MultiFind(ReadyNode.NodeID, WaitingNodes, true);
+		if (WaitingNodes.Num() > 0)
+		{
+			PendingTreeNodes.Remove(ReadyNode.NodeID);
+			for (int32 i = WaitingNodes.Num() - 1; i >= 0; i--)
+			{
+				ReadyNodes.Emplace(WaitingNodes[i], NodeIndex);
+			}
+		}
+	}
+}
+
+void UBCustomTreeView::FinishTreeBuild()
+{
+	TreeBuildTickerHandle.Reset();
+
+	// Nodes still waiting either wait for a parent that is not in TreeNodes, or for each other in a cycle.
+	BuildReport.NumNodes = NodeStore->NumNodes();
+	BuildReport.NumUnplacedNodes = TreeBuildNumUsableNodes - BuildReport.NumNodes;
+	if (PendingTreeNodes.Num() > 0)
+	{
+		TSet<int32> UnplacedNodes;
+		TArray<int32> PendingNodes;
+		for (const auto& Pending : PendingTreeNodes)
+		{
+			UnplacedNodes.Add(Pending.Value);
+
+			const int64 ParentID = Pending.Key;
+			const bool bParentExists = UseStableNodeIDs ? TreeNodePositions.Contains(ParentID) : ParentID >= 0 && ParentID < TreeBuildEnd && TreeNodes[(int32)ParentID].ParentID >= 0;
+			if (!bParentExists)
+			{
+				BuildReport.OrphanNodeIDs.Add(TreeNodes[Pending.Value].NodeID);
+				PendingNodes.Add(Pending.Value);
+			}
+		}
+
+		TArray<int32> WaitingNodes;
+		for (int32 Head = 0; Head < PendingNodes.Num(); Head++)
+		{
+			UnplacedNodes.Remove(PendingNodes[Head]);
+			WaitingNodes.Reset();
+			PendingTreeNodes.MultiFind(TreeNodes[PendingNodes[Head]].NodeID, WaitingNodes, true);
+			PendingNodes.Append(WaitingNodes);
+		}
+		for (int32 Position : UnplacedNodes)
+		{
+			BuildReport.CycleNodeIDs.Add(TreeNodes[Position].NodeID);
+		}
+		PendingTreeNodes.Empty();
+	}
+	BuildReport.BuildTimeMs = (FPlatformTime::Seconds() - TreeBuildStartTime) * 1000.0;
+	LogBuildReport();
+
+	if (TreeViewWidget.IsValid())
+	{
+		TreeViewWidget->RefreshTree();
+		TreeViewWidget->RestoreViewState(true);
+	}
+	InvalidateFilter();
+	OnTreeBuildProgress.Broadcast(1.0f, BuildReport.NumNodes);
+	OnTreeReady.Broadcast(BuildReport);
+}
+
+const FBTreeBuildReport& UBCustomTreeView::GetBuildReport() const
+{
+	return BuildReport;
+}
+
+bool UBCustomTreeView::SaveTreeSnapshot(const FString& Filename) const
+{
+	return NodeStore->SaveSnapshot(Filename, UseStableNodeIDs ? SnapshotStableNodeIDs : 0);
+}
+
+bool UBCustomTreeView::LoadTreeSnapshot(const FString& Filename)
+{
+	StopTreeBuild();
+	EnsureWidgetValidity();
+
+	WaitForFilter();
+
+	uint32 Flags = 0;
+	TreeViewWidget->SaveViewState();
+	NodeStore->SetNameIndexEnabled(false);
+	bExternalTree = NodeStore->LoadSnapshot(Filename, Flags);
+	NodeStore->SetNameIndexEnabled(IndexNodeNames);
+	ApplySort();
+	RefreshRowContentRules();
+	RefreshAggregates();
+	CollapsedLazyNodes.Reset();
+	if (bExternalTree)
+	{
+		UseStableNodeIDs = (Flags & SnapshotStableNodeIDs) != 0;
+	}
+	TreeNodes.Empty();
+	TreeNodePositions.Empty();
+	BuildReport = FBTreeBuildReport();
+	BuildReport.NumNodes = NodeStore->NumNodes();
+
+	TreeViewWidget->RebuildTree();
+	TreeViewWidget->RestoreViewState(true);
+	RefreshFilter();
+	return bExternalTree;
+}
+
+bool UBCustomTreeView::AddNode(const FBTreeNode& Node, int64& NodeID)
+{
+	CompleteTreeBuild();
+	EnsureWidgetValidity();
+
+	int32 ParentIndex;
+	if (!FindParentIndex(Node.ParentID, ParentIndex))
+	{
+		return false;
+	}
+
+	NodeID = UseStableNodeIDs ? Node.NodeID : TreeNodes.Num();
+	if (UseStableNodeIDs && (NodeID == 0 || TreeNodePositions.Contains(NodeID)))
+	{
+		return false;
+	}
+	WaitForFilter();
+	const int32 NodeIndex = NodeStore->AddNode(NodeID, ParentIndex, Node.NodeName, Node.NodePadding, Node.ExtraStrings, GetStoreFlags(Node));
+	if (NodeIndex == INDEX_NONE)
+	{
+		return false;
+	}
+	if (FBTreeAggregates* UpToDateAggregates = GetUpToDateAggregates())
+	{
+		UpToDateAggregates->AddNode(*NodeStore, NodeIndex);
+	}
+	if (Sort.IsValid())
+	{
+		Sort->InsertSorted(*NodeStore, { NodeIndex });
+	}
+
+	const int32 Position = TreeNodes.Add(Node);
+	TreeNodes[Position].NodeID = NodeID;
+	if (UseStableNodeIDs)
+	{
+		TreeNodePositions.Add(NodeID, Position);
+	}
+
+	TreeViewWidget->RefreshTree();
+	InvalidateFilter();
+	return true;
+}
+
+void UBCustomTreeView::RemoveSubtree(int64 NodeId)
+{
+	CompleteTreeBuild();
+	EnsureWidgetValidity();
+	const int32 NodeIndex = NodeStore->FindNode(NodeId);
+	if (NodeIndex == INDEX_NONE)
+	{
+		return;
+	}
+
+	RemoveStoreSubtree(NodeIndex);
+	TreeViewWidget->RefreshTree();
+}
+
+void UBCustomTreeView::RemoveStoreSubtree(int32 NodeIndex)
+{
+	RemoveStoreSubtrees({ NodeIndex });
+}
+
+void UBCustomTreeView::RemoveStoreSubtrees(const TArray<int32>& NodeIndices)
+{
+	InvalidateRowContents();
+	WaitForFilter();
+
+	FBTreeAggregates* UpToDateAggregates = GetUpToDateAggregates();
+	TArray<int32> RemovedNodes;
+	for (int32 NodeIndex : NodeIndices)
+	{
+		// A subtree may have gone with an earlier one of the batch, as children of nested expired nodes do.
+		if (!NodeStore->IsValidNode(NodeIndex))
+		{
+			continue;
+		}
+		if (UpToDateAggregates)
+		{
+			UpToDateAggregates->UnlinkSubtree(*NodeStore, NodeIndex);
+		}
+		NodeStore->RemoveSubtree(NodeIndex, &RemovedNodes);
+	}
+	for (int32 RemovedNode : RemovedNodes)
+	{
+		RemoveTreeNodeEntry(NodeStore->GetKey(RemovedNode));
+		CollapsedLazyNodes.Remove(RemovedNode);
+	}
+
+	TreeViewWidget->OnNodesRemoved(RemovedNodes);
+	InvalidateFilter();
+}
+
+bool UBCustomTreeView::ProvideChildren(int64 NodeId, const TArray<FBTreeNode>& Children)
+{
+	const int32 NodeIndex = NodeStore->FindNode(NodeId);
+	if (NodeIndex == INDEX_NONE || !(NodeStore->GetFlags(NodeIndex) & EBTreeNodeFlags::ChildrenLoading))
+	{
+		return false;
+	}
+
+	WaitForFilter();
+	NodeStore->SetFlags(NodeIndex, EBTreeNodeFlags::LazyChildren | EBTreeNodeFlags::ChildrenLoaded);
+	FBTreeAggregates* UpToDateAggregates = GetUpToDateAggregates();
+	for (const FBTreeNode& Child : Children)
+	{
+		const int32 ChildIndex = Child.NodeID != 0 ? NodeStore->AddNode(Child.NodeID, NodeIndex, Child.NodeName, Child.NodePadding, Child.ExtraStrings, GetStoreFlags(Child)) : INDEX_NONE;
+		if (ChildIndex == INDEX_NONE)
+		{
+			UE_LOG(LogBTreeView, Warning, TEXT("%s: skipping provided child, NodeID %lld is reserved or already used"), *GetName(), Child.NodeID);
+		}
+		else if (UpToDateAggregates)
+		{
+			UpToDateAggregates->AddNode(*NodeStore, ChildIndex);
+		}
+	}
+	if (Sort.IsValid())
+	{
+		Sort->SortChildren(*NodeStore, NodeIndex);
+	}
+
+	// The node may have been collapsed while its children were loading.
+	if (TreeViewWidget.IsValid())
+	{
+		if (!TreeViewWidget->IsItemExpanded(TreeViewWidget->GetNodeHandle(NodeIndex)))
+		{
+			CollapsedLazyNodes.Add(NodeIndex, FPlatformTime::Seconds());
+		}
+		TreeViewWidget->RefreshTree();
+	}
+	InvalidateFilter();
+	return true;
+}
+
+void UBCustomTreeView::RequestLazyChildren(int32 NodeIndex)
+{
+	if (!UseStableNodeIDs)
+	{
+		UE_LOG(LogBTreeView, Warning, TEXT("%s: lazy children require UseStableNodeIDs"), *GetName());
+		return;
+	}
+
+	// Without a provider the node simply has no children.
+	NodeStore->SetFlags(NodeIndex, EBTreeNodeFlags::LazyChildren | EBTreeNodeFlags::ChildrenLoading);
+	if (!ChildProvider || !ChildProvider->GetClass()->ImplementsInterface(UBTreeChildProvider::StaticClass()))
+	{
+		ProvideChildren(NodeStore->GetKey(NodeIndex), TArray<FBTreeNode>());
+		return;
+	}
+
+	FBTreeNode Node;
+	MakeTreeNode(NodeIndex, Node);
+	IBTreeChildProvider::Execute_RequestChildren(ChildProvider, this, Node);
+}
+
+void UBCustomTreeView::HandleOnLazyNodeExpansionChanged(int32 NodeIndex, bool ExpansionState)
+{
+	const uint8 NodeFlags = NodeStore->GetFlags(NodeIndex);
+	if (!(NodeFlags & EBTreeNodeFlags::LazyChildren))
+	{
+		return;
+	}
+
+	if (!ExpansionState)
+	{
+		if (NodeFlags & EBTreeNodeFlags::ChildrenLoaded)
+		{
+			CollapsedLazyNodes.Add(NodeIndex, FPlatformTime::Seconds());
+		}
+		return;
+	}
+
+	CollapsedLazyNodes.Remove(NodeIndex);
+	if (!(NodeFlags & (EBTreeNodeFlags::ChildrenLoading | EBTreeNodeFlags::ChildrenLoaded)))
+	{
+		RequestLazyChildren(NodeIndex);
+	}
+}
+
+void UBCustomTreeView::EvictLazyChildren(double CurrentTime)
+{
+	if (LazyChildrenLifetime <= 0.0f || CollapsedLazyNodes.Num() == 0)
+	{
+		return;
+	}
+
+	TArray<int32> ExpiredNodes;
+	for (const auto& CollapsedNode : CollapsedLazyNodes)
+	{
+		if (CurrentTime - CollapsedNode.Value >= LazyChildrenLifetime)
+		{
+			ExpiredNodes.Add(CollapsedNode.Key);
+		}
+	}
+	if (ExpiredNodes.Num() == 0)
+	{
+		return;
+	}
+
+	TArray<int32> Children;
+	for (int32 NodeIndex : ExpiredNodes)
+	{
+		CollapsedLazyNodes.Remove(NodeIndex);
+		NodeStore->GetChildren(NodeIndex, Children);
+		NodeStore->SetFlags(NodeIndex, EBTreeNodeFlags::LazyChildren);
+	}
+	RemoveStoreSubtrees(Children);
+	TreeViewWidget->RefreshTree();
+}
+
+bool UBCustomTreeView::MoveNode(int64 NodeId, int64 NewParentID)
+{
+	CompleteTreeBuild();
+	EnsureWidgetValidity();
+	const int32 NodeIndex = NodeStore->FindNode(NodeId);
+	int32 NewParentIndex;
+	if (NodeIndex == INDEX_NONE || !FindParentIndex(NewParentID, NewParentIndex))
+	{
+		return false;
+	}
+
+	return MoveNodeIndices({ NodeIndex }, NewParentIndex, INDEX_NONE);
+}
+
+bool UBCustomTreeView::MoveNodes(const TArray<int64>& NodeIds, int64 NewParentID, int64 BeforeNodeID)
+{
+	CompleteTreeBuild();
+	EnsureWidgetValidity();
+	int32 NewParentIndex;
+	if (!FindParentIndex(NewParentID, NewParentIndex))
+	{
+		return false;
+	}
+
+	TArray<int32> NodeIndices;
+	NodeIndices.Reserve(NodeIds.Num());
+	for (int64 NodeId : NodeIds)
+	{
+		const int32 NodeIndex = NodeStore->FindNode(NodeId);
+		if (NodeIndex == INDEX_NONE)
+		{
+			return false;
+		}
+		NodeIndices.Add(NodeIndex);
+	}
+
+	int32 BeforeIndex = INDEX_NONE;
+	if (BeforeNodeID != 0)
+	{
+		BeforeIndex = NodeStore->FindNode(BeforeNodeID);
+		if (BeforeIndex == INDEX_NONE || NodeStore->GetParent(BeforeIndex) != NewParentIndex)
+		{
+			return false;
+		}
+	}
+	return MoveNodeIndices(NodeIndices, NewParentIndex, BeforeIndex);
+}
+
+bool UBCustomTreeView::MoveNodeIndices(const TArray<int32>& NodeIndices, int32 NewParentIndex, int32 BeforeIndex)
+{
+	CompleteTreeBuild();
+	EnsureWidgetValidity();
+	if (NodeIndices.Num() == 0)
+	{
+		return false;
+	}
+
+	TSet<int32> MovedNodes;
+	MovedNodes.Reserve(NodeIndices.Num());
+	for (int32 NodeIndex : NodeIndices)
+	{
+		if (!NodeStore->IsValidNode(NodeIndex))
+		{
+			return false;
+		}
+		MovedNodes.Add(NodeIndex);
+	}
+
+	// The new parent must not be one of the nodes or one of their descendants, which a single walk up from it tells.
+	for (int32 Ancestor = NewParentIndex; Ancestor != INDEX_NONE; Ancestor = NodeStore->GetParent(Ancestor))
+	{
+		if (MovedNodes.Contains(Ancestor))
+		{
+			return false;
+		}
+	}
+
+	// The nodes are placed before the first sibling that does not move, each one before the same sibling keeping their order.
+	while (BeforeIndex != INDEX_NONE && MovedNodes.Contains(BeforeIndex))
+	{
+		BeforeIndex = NodeStore->GetNextSibling(BeforeIndex);
+	}
+
+	WaitForFilter();
+	FBTreeAggregates* UpToDateAggregates = GetUpToDateAggregates();
+	for (int32 NodeIndex : NodeIndices)
+	{
+		if (UpToDateAggregates)
+		{
+			UpToDateAggregates->UnlinkSubtree(*NodeStore, NodeIndex);
+		}
+		NodeStore->MoveNode(NodeIndex, NewParentIndex, BeforeIndex);
+		if (UpToDateAggregates)
+		{
+			UpToDateAggregates->LinkSubtree(*NodeStore, NodeIndex);
+		}
+	}
+	if (Sort.IsValid())
+	{
+		Sort->InsertSorted(*NodeStore, NodeIndices);
+	}
+	InvalidateRowContents();
+	InvalidateFilter();
+
+	const int64 NewParentID = GetParentNodeID(NodeIndices[0]);
+	TArray<int64> NodeIds;
+	NodeIds.Reserve(NodeIndices.Num());
+	for (int32 NodeIndex : NodeIndices)
+	{
+		const int64 NodeId = NodeStore->GetKey(NodeIndex);
+		if (FBTreeNode* Entry = FindTreeNodeEntry(NodeId))
+		{
+			Entry->ParentID = NewParentID;
+		}
+		NodeIds.Add(NodeId);
+	}
+
+	TreeViewWidget->RefreshTree();
+	OnNodesMoved.Broadcast(NodeIds, NewParentID);
+	return true;
+}
+
+void UBCustomTreeView::UpdateNode(const FBTreeNode& Node)
+{
+	CompleteTreeBuild();
+	EnsureWidgetValidity();
+	const int32 NodeIndex = NodeStore->FindNode(Node.NodeID);
+	if (NodeIndex == INDEX_NONE)
+	{
+		return;
+	}
+
+	if (FBTreeNode* Entry = FindTreeNodeEntry(Node.NodeID))
+	{
+		Entry->NodeName = Node.NodeName;
+		Entry->NodePadding = Node.NodePadding;
+		Entry->ExtraStrings = Node.ExtraStrings;
+	}
+
+	WaitForFilter();
+	NodeStore->SetName(NodeIndex, Node.NodeName);
+	NodeStore->SetPadding(NodeIndex, Node.NodePadding);
+	NodeStore->SetExtraStrings(NodeIndex, Node.ExtraStrings);
+	if (FBTreeAggregates* UpToDateAggregates = GetUpToDateAggregates())
+	{
+		UpToDateAggregates->UpdateNode(*NodeStore, NodeIndex);
+	}
+	CachedRowContents.Remove(NodeIndex);
+	InvalidateFilter();
+	TreeViewWidget->RefreshTreeItem(NodeIndex);
+
+	// The node sorts elsewhere if its name or extra strings changed.
+	if (Sort.IsValid())
+	{
+		Sort->InsertSorted(*NodeStore, { NodeIndex });
+		TreeViewWidget->RefreshTree();
+	}
+}
+
+void UBCustomTreeView::SetSortMode(EBTreeSortMode Mode, int32 ExtraStringIndex, bool bDescending)
+{
+	SortMode = Mode;
+	SortExtraStringIndex = ExtraStringIndex;
+	SortDescending = bDescending;
+	NativeSortLess = nullptr;
+	ResortTree();
+}
+
+void UBCustomTreeView::SetSortComparator(const FBTreeNodeLess& Less, bool bDescending)
+{
+	NativeSortLess = Less;
+	SortDescending = bDescending;
+	ResortTree();
+}
+
+void UBCustomTreeView::ResortTree()
+{
+	EnsureWidgetValidity();
+	WaitForFilter();
+	ApplySort();
+	TreeViewWidget->RefreshTree();
+}
+
+void UBCustomTreeView::ApplySort()
+{
+	// Nodes added since the last sort are sorted along with the others.
+	UnsortedNodes.Reset();
+	if (NativeSortLess)
+	{
+		Sort = MakeShared<FBTreeSort>(NativeSortLess, SortDescending);
+	}
+	else if (SortMode != EBTreeSortMode::None)
+	{
+		Sort = MakeShared<FBTreeSort>(SortMode == EBTreeSortMode::Natural, FMath::Max(SortExtraStringIndex, (int32)INDEX_NONE), SortDescending);
+	}
+	else
+	{
+		Sort.Reset();
+		return;
+	}
+	Sort->SortAll(*NodeStore);
+}
+
+void UBCustomTreeView::SortUnsortedNodes()
+{
+	if (Sort.IsValid() && UnsortedNodes.Num() > 0)
+	{
+		Sort->InsertSorted(*NodeStore, UnsortedNodes);
+	}
+	UnsortedNodes.Reset();
+}
+
+void UBCustomTreeView::RefreshAggregates()
+{
+	if (Aggregates.Num() == 0)
+	{
+		NodeAggregates.Reset();
+		return;
+	}
+
+	// Both enums list the operations in the same order.
+	TArray<FBTreeAggregates::FAggregate> Definitions;
+	Definitions.Reserve(Aggregates.Num());
+	for (const FBTreeAggregate& Aggregate : Aggregates)
+	{
+		Definitions.Add({ static_cast<FBTreeAggregates::EOperation>(Aggregate.Operation), Aggregate.ExtraStringIndex });
+	}
+	NodeAggregates = MakeShared<FBTreeAggregates>(Definitions);
+	bAggregatesPending = true;
+}
+
+FBTreeAggregates* UBCustomTreeView::GetUpToDateAggregates() const
+{
+	return NodeAggregates.IsValid() && !bAggregatesPending ? NodeAggregates.Get() : nullptr;
+}
+
+void UBCustomTreeView::SetFilterText(const FString& Text, bool bMatchExtraStrings)
+{
+	if (Text.IsEmpty())
+	{
+		ClearFilter();
+		return;
+	}
+
+	// The expansion the filter is about to change is given back by ClearFilter.
+	if (FilterText.IsEmpty() && TreeViewWidget.IsValid())
+	{
+		TreeViewWidget->SaveFilterExpansion();
+	}
+
+	FilterText = Text;
+	bFilterExtraStrings = bMatchExtraStrings;
+
+	// A filter that is still running is applied first, then narrowed by TickFilter.
+	if (!PendingFilter.IsValid())
+	{
+		StartFilter();
+	}
+}
+
+void UBCustomTreeView::ClearFilter()
+{
+	WaitForFilter();
+	PendingFilter = TFuture<FBTreeFilterResultPtr>();
+	if (FilterTickerHandle.IsValid())
+	{
+		FTicker::GetCoreTicker().RemoveTicker(FilterTickerHandle);
+		FilterTickerHandle.Reset();
+	}
+
+	const bool bWasFiltering = FilterResult.IsValid();
+	FilterText.Empty();
+	FilterResult.Reset();
+	bFilterStale = false;
+	if (bWasFiltering && TreeViewWidget.IsValid())
+	{
+		TreeViewWidget->SetFilter(nullptr);
+	}
+	if (TreeViewWidget.IsValid())
+	{
+		TreeViewWidget->RestoreFilterExpansion();
+	}
+}
+
+bool UBCustomTreeView::IsFiltering() const
+{
+	return !FilterText.IsEmpty();
+}
+
+bool UBCustomTreeView::GetNodeFilterMatch(const FBTreeNodeHandle& Node, FBTreeFilterMatch& Match) const
+{
+	const int32 NodeIndex = ResolveNodeHandle(Node);
+	const FBTreeNodeMatch* NodeMatch = FilterResult.IsValid() && NodeIndex != INDEX_NONE ? FilterResult->FindMatch(NodeIndex) : nullptr;
+	if (!NodeMatch)
+	{
+		Match = FBTreeFilterMatch();
+		return false;
+	}
+
+	Match.ExtraStringIndex = NodeMatch->StringIndex;
+	Match.Start = NodeMatch->Start;
+	Match.Length = FilterResult->Text.Len();
+	return true;
+}
+
+void UBCustomTreeView::StartFilter()
+{
+	// Only a result of the unchanged store can be narrowed.
+	const FBTreeFilterResultPtr Previous = bFilterStale ? FBTreeFilterResultPtr() : FilterResult;
+	bFilterStale = false;
+	PendingFilter = FBTreeFilter::FilterAsync(*NodeStore, FilterText, bFilterExtraStrings, Previous);
+
+	if (!FilterTickerHandle.IsValid())
+	{
+		FilterTickerHandle = FTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateUObject(this, &UBCustomTreeView::TickFilter));
+	}
+}
+
+bool UBCustomTreeView::TickFilter(float DeltaTime)
+{
+	if (PendingFilter.IsValid())
+	{
+		if (!PendingFilter.IsReady())
+		{
+			return true;
+		}
+		CompleteFilter();
+	}
+
+	// The text or the nodes may have changed while the filter was running.
+	if (FilterResult.IsValid() && (bFilterStale || FilterResult->Text != FilterText || FilterResult->bMatchExtraStrings != bFilterExtraStrings))
+	{
+		StartFilter();
+		return true;
+	}
+
+	// Returning false removes the ticker.
+	FilterTickerHandle.Reset();
+	return false;
+}
+
+void UBCustomTreeView::CompleteFilter()
+{
+	if (!PendingFilter.IsValid())
+	{
+		return;
+	}
+
+	const FBTreeFilterResultPtr Result = PendingFilter.Get();
+	PendingFilter = TFuture<FBTreeFilterResultPtr>();
+
+	// The whole result is swapped in at once, the tree never shows a partly applied filter.
+	FilterResult = Result;
+	if (TreeViewWidget.IsValid())
+	{
+		TreeViewWidget->SetFilter(FilterResult);
+
+		// Ancestors of a stale result may be other nodes by now, they are expanded by the next result.
+		if (!bFilterStale)
+		{
+			TreeViewWidget->SetNodesExpansion(FilterResult->Ancestors, true);
+		}
+	}
+	OnFilterApplied.Broadcast(FilterResult->Matches.Num());
+}
+
+bool UBCustomTreeView::IsFilterRunning() const
+{
+	return PendingFilter.IsValid() && !PendingFilter.IsReady();
+}
+
+void UBCustomTreeView::WaitForFilter()
+{
+	if (PendingFilter.IsValid())
+	{
+		PendingFilter.Wait();
+	}
+}
+
+void UBCustomTreeView::InvalidateFilter()
+{
+	if (!FilterText.IsEmpty())
+	{
+		bFilterStale = true;
+		if (!FilterTickerHandle.IsValid())
+		{
+			FilterTickerHandle = FTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateUObject(this, &UBCustomTreeView::TickFilter));
+		}
+	}
+}
+
+void UBCustomTreeView::RefreshFilter()
+{
+	if (!FilterText.IsEmpty())
+	{
+		bFilterStale = true;
+		StartFilter();
+		PendingFilter.Wait();
+		CompleteFilter();
+	}
+}
+
+void UBCustomTreeView::RefreshRowContentRules()
+{
+	CompiledRowContentsById.Reset();
+	for (const FBRowContentTypeById& Rule : RowContentsById)
+	{
+		if (Rule.RowContent && !CompiledRowContentsById.Contains(Rule.NodeId))
+		{
+			CompiledRowContentsById.Add(Rule.NodeId, Rule.RowContent);
+		}
+	}
+
+	CompiledRowContentsByParent.Reset();
+	for (const FBRowContentTypeByParent& Rule : RowContentsByParent)
+	{
+		if (Rule.RowContent && !CompiledRowContentsByParent.Contains(Rule.ParentID))
+		{
+			CompiledRowContentsByParent.Add(Rule.ParentID, Rule.RowContent);
+		}
+	}
+
+	// One table per ExtraStrings index, in the order the index first appears in the rules.
+	CompiledRowContentsByExtraString.Reset();
+	for (const FBRowContentTypeByExtraString& Rule : RowContentsByExtraString)
+	{
+		if (!Rule.RowContent || Rule.ExtraStringIndex < 0)
+		{
+			continue;
+		}
+
+		TMap<FString, UClass*>* Table = nullptr;
+		for (auto& CompiledRule : CompiledRowContentsByExtraString)
+		{
+			if (CompiledRule.Key == Rule.ExtraStringIndex)
+			{
+				Table = &CompiledRule.Value;
+				break;
+			}
+		}
+		if (!Table)
+		{
+			Table = &CompiledRowContentsByExtraString.Emplace_GetRef(Rule.ExtraStringIndex, TMap<FString, UClass*>()).Value;
+		}
+		if (!Table->Contains(Rule.Value))
+		{
+			Table->Add(Rule.Value, Rule.RowContent);
+		}
+	}
+
+	CompiledRowContentsByDepth.Reset();
+	for (const FBRowContentTypeByDepth& Rule : RowContentsByDepth)
+	{
+		if (Rule.RowContent && Rule.Depth >= 0)
+		{
+			if (Rule.Depth >= CompiledRowContentsByDepth.Num())
+			{
+				CompiledRowContentsByDepth.SetNumZeroed(Rule.Depth + 1);
+			}
+			if (!CompiledRowContentsByDepth[Rule.Depth])
+			{
+				CompiledRowContentsByDepth[Rule.Depth] = Rule.RowContent;
+			}
+		}
+	}
+
+	InvalidateRowContents();
+}
+
+void UBCustomTreeView::InvalidateRowContents()
+{
+	CachedRowContents.Reset();
+}
+
+UClass* UBCustomTreeView::GetRowContentClass(int32 NodeIndex)
+{
+	if (UClass** CachedClass = CachedRowContents.Find(NodeIndex))
+	{
+		return *CachedClass;
+	}
+
+	UClass* RowContentClass = DefaultRowContent;
+	if (UClass** ClassById = CompiledRowContentsById.Find(NodeStore->GetKey(NodeIndex)))
+	{
+		RowContentClass = *ClassById;
+	}
+	else if (UClass** ClassByParent = CompiledRowContentsByParent.Find(GetParentNodeID(NodeIndex)))
+	{
+		RowContentClass = *ClassByParent;
+	}
+	else
+	{
+		bool bMatched = false;
+		for (const auto& CompiledRule : CompiledRowContentsByExtraString)
+		{
+			if (CompiledRule.Key < NodeStore->GetNumExtraStrings(NodeIndex))
+			{
+				if (UClass* const* ClassByExtraString = CompiledRule.Value.Find(NodeStore->GetExtraString(NodeIndex, CompiledRule.Key)))
+				{
+					RowContentClass = *ClassByExtraString;
+					bMatched = true;
+					break;
+				}
+			}
+		}
+
+		const int32 Depth = NodeStore->GetDepth(NodeIndex);
+		if (!bMatched && CompiledRowContentsByDepth.IsValidIndex(Depth) && CompiledRowContentsByDepth[Depth])
+		{
+			RowContentClass = CompiledRowContentsByDepth[Depth];
+		}
+	}
+
+	CachedRowContents.Add(NodeIndex, RowContentClass);
+	return RowContentClass;
+}
+
+UUserWidget* UBCustomTreeView::AcquireRowContent(UWorld* World, TSubclassOf<class UUserWidget> RowContentClass, bool& bOutReused)
+{
+	FBRowContentPool* Pool = RowContentPools.Find(RowContentClass);
+	if (Pool && Pool->FreeWidgets.Num() > 0)
+	{
+		UUserWidget* RowWidget = Pool->FreeWidgets.Pop(false);
+		Pool->FreeSlateWidgets.Pop(false);
+		if (RowWidget)
+		{
+			RowContentPoolHits++;
+			bOutReused = true;
+			return RowWidget;
+		}
+	}
+
+	RowContentPoolMisses++;
+	bOutReused = false;
+	return CreateWidget<UUserWidget>(World, RowContentClass);
+}
+
+void UBCustomTreeView::ReleaseRowContent(UUserWidget* RowWidget)
+{
+	if (!RowWidget || RowContentPoolSize <= 0)
+	{
+		return;
+	}
+
+	FBRowContentPool& Pool = RowContentPools.FindOrAdd(RowWidget->GetClass());
+	if (Pool.FreeWidgets.Num() < RowContentPoolSize)
+	{
+		Pool.FreeWidgets.Add(RowWidget);
+		Pool.FreeSlateWidgets.Add(RowWidget->GetCachedWidget());
+	}
+}
+
+int32 UBCustomTreeView::GetRowContentPoolHits() const
+{
+	return RowContentPoolHits;
+}
+
+int32 UBCustomTreeView::GetRowContentPoolMisses() const
+{
+	return RowContentPoolMisses;
+}
+
+int32 UBCustomTreeView::GetNumPooledRowContents() const
+{
+	int32 NumPooled = 0;
+	for (const auto& Pool : RowContentPools)
+	{
+		NumPooled += Pool.Value.FreeWidgets.Num();
+	}
+	return NumPooled;
+}
+
+void UBCustomTreeView::EmptyRowContentPool()
+{
+	RowContentPools.Empty();
+	RowContentPoolHits = 0;
+	RowContentPoolMisses = 0;
+}
+
+void UBCustomTreeView::FindNodesByName(const FString& Query, int32 MaxResults, TArray<int64>& NodeIds)
+{
+	WaitForFilter();
+	NodeStore->SetNameIndexEnabled(IndexNodeNames);
+
+	TArray<FBTreeNameHit> Hits;
+	if (const FBTreeNameIndex* NameIndex = NodeStore->GetNameIndex())
+	{
+		NameIndex->Query(Query, MaxResults, Hits);
+	}
+	else
+	{
+		FBTreeNameIndex::QueryStore(*NodeStore, Query, MaxResults, Hits);
+	}
+
+	NodeIds.Reset(Hits.Num());
+	for (const FBTreeNameHit& Hit : Hits)
+	{
+		NodeIds.Add(NodeStore->GetKey(Hit.NodeIndex));
+	}
+}
+
+bool UBCustomTreeView::FindNodeHandle(int64 NodeId, FBTreeNodeHandle& Node) const
+{
+	const int32 NodeIndex = NodeStore->FindNode(NodeId);
+	Node = NodeIndex != INDEX_NONE ? MakeNodeHandle(NodeIndex) : FBTreeNodeHandle();
+	return NodeIndex != INDEX_NONE;
+}
+
+bool UBCustomTreeView::IsValidNodeHandle(const FBTreeNodeHandle& Node) const
+{
+	return ResolveNodeHandle(Node) != INDEX_NONE;
+}
+
+bool UBCustomTreeView::GetNodeData(const FBTreeNodeHandle& Node, FBTreeNode& Data) const
+{
+	const int32 NodeIndex = ResolveNodeHandle(Node);
+	if (NodeIndex == INDEX_NONE)
+	{
+		return false;
+	}
+
+	MakeTreeNode(NodeIndex, Data);
+	return true;
+}
+
+FString UBCustomTreeView::GetNodeName(const FBTreeNodeHandle& Node) const
+{
+	const int32 NodeIndex = ResolveNodeHandle(Node);
+	return NodeIndex != INDEX_NONE ? FString(NodeStore->GetName(NodeIndex)) : FString();
+}
+
+int64 UBCustomTreeView::GetNodeParentID(const FBTreeNodeHandle& Node) const
+{
+	const int32 NodeIndex = ResolveNodeHandle(Node);
+	return NodeIndex != INDEX_NONE ? GetParentNodeID(NodeIndex) : 0;
+}
+
+bool UBCustomTreeView::GetNodeParent(const FBTreeNodeHandle& Node, FBTreeNodeHandle& Parent) const
+{
+	const int32 NodeIndex = ResolveNodeHandle(Node);
+	const int32 ParentIndex = NodeIndex != INDEX_NONE ? NodeStore->GetParent(NodeIndex) : INDEX_NONE;
+	Parent = ParentIndex != INDEX_NONE ? MakeNodeHandle(ParentIndex) : FBTreeNodeHandle();
+	return ParentIndex != INDEX_NONE;
+}
+
+int32 UBCustomTreeView::GetNodeNumChildren(const FBTreeNodeHandle& Node) const
+{
+	const int32 NodeIndex = ResolveNodeHandle(Node);
+	return NodeIndex != INDEX_NONE ? NodeStore->GetNumChildren(NodeIndex) : 0;
+}
+
+void UBCustomTreeView::GetNodeChildren(const FBTreeNodeHandle& Node, TArray<FBTreeNodeHandle>& Children) const
+{
+	Children.Reset();
+	const int32 NodeIndex = ResolveNodeHandle(Node);
+	if (NodeIndex == INDEX_NONE)
+	{
+		return;
+	}
+
+	Children.Reserve(NodeStore->GetNumChildren(NodeIndex));
+	for (int32 Child = NodeStore->GetFirstChild(NodeIndex); Child != INDEX_NONE; Child = NodeStore->GetNextSibling(Child))
+	{
+		Children.Add(MakeNodeHandle(Child));
+	}
+}
+
+int32 UBCustomTreeView::GetNodeNumExtraStrings(const FBTreeNodeHandle& Node) const
+{
+	const int32 NodeIndex = ResolveNodeHandle(Node);
+	return NodeIndex != INDEX_NONE ? NodeStore->GetNumExtraStrings(NodeIndex) : 0;
+}
+
+FString UBCustomTreeView::GetNodeExtraString(const FBTreeNodeHandle& Node, int32 Index) const
+{
+	const int32 NodeIndex = ResolveNodeHandle(Node);
+	if (NodeIndex == INDEX_NONE || Index < 0 || Index >= NodeStore->GetNumExtraStrings(NodeIndex))
+	{
+		return FString();
+	}
+	return NodeStore->GetExtraString(NodeIndex, Index);
+}
+
+int32 UBCustomTreeView::GetNodeDepth(const FBTreeNodeHandle& Node) const
+{
+	const int32 NodeIndex = ResolveNodeHandle(Node);
+	return NodeIndex != INDEX_NONE ? NodeStore->GetDepth(NodeIndex) : 0;
+}
+
+bool UBCustomTreeView::IsNodeAncestorOf(const FBTreeNodeHandle& Ancestor, const FBTreeNodeHandle& Node) const
+{
+	const int32 AncestorIndex = ResolveNodeHandle(Ancestor);
+	const int32 NodeIndex = ResolveNodeHandle(Node);
+	return AncestorIndex != INDEX_NONE && NodeIndex != INDEX_NONE && NodeStore->IsAncestor(AncestorIndex, NodeIndex);
+}
+
+int32 UBCustomTreeView::GetNodeSubtreeSize(const FBTreeNodeHandle& Node) const
+{
+	const int32 NodeIndex = ResolveNodeHandle(Node);
+	return NodeIndex != INDEX_NONE ? NodeStore->GetSubtreeSize(NodeIndex) : 0;
+}
+
+bool UBCustomTreeView::FindCommonAncestor(const FBTreeNodeHandle& A, const FBTreeNodeHandle& B, FBTreeNodeHandle& Ancestor) const
+{
+	const int32 IndexA = ResolveNodeHandle(A);
+	const int32 IndexB = ResolveNodeHandle(B);
+	const int32 AncestorIndex = IndexA != INDEX_NONE && IndexB != INDEX_NONE ? NodeStore->FindCommonAncestor(IndexA, IndexB) : INDEX_NONE;
+	Ancestor = AncestorIndex != INDEX_NONE ? MakeNodeHandle(AncestorIndex) : FBTreeNodeHandle();
+	return AncestorIndex != INDEX_NONE;
+}
+
+void UBCustomTreeView::GetSubtreeNodes(const FBTreeNodeHandle& Node, TArray<FBTreeNodeHandle>& Nodes) const
+{
+	Nodes.Reset();
+	const int32 NodeIndex = ResolveNodeHandle(Node);
+	if (NodeIndex == INDEX_NONE)
+	{
+		return;
+	}
+
+	const TArrayView<const int32> Subtree = NodeStore->GetSubtree(NodeIndex);
+	Nodes.Reserve(Subtree.Num());
+	for (int32 Descendant : Subtree)
+	{
+		Nodes.Add(MakeNodeHandle(Descendant));
+	}
+}
+
+float UBCustomTreeView::GetNodeAggregate(const FBTreeNodeHandle& Node, int32 AggregateIndex) const
+{
+	const int32 NodeIndex = ResolveNodeHandle(Node);
+	if (NodeIndex == INDEX_NONE || !NodeAggregates.IsValid() || AggregateIndex < 0 || AggregateIndex >= NodeAggregates->Num())
+	{
+		return 0.0f;
+	}
+
+	if (bAggregatesPending)
+	{
+		NodeAggregates->Build(*NodeStore);
+		bAggregatesPending = false;
+	}
+	return (float)NodeAggregates->GetValue(AggregateIndex, NodeIndex);
+}
+
+FBTreeNodeHandle UBCustomTreeView::MakeNodeHandle(int32 NodeIndex) const
+{
+	FBTreeNodeHandle Node;
+	Node.NodeID = NodeStore->GetKey(NodeIndex);
+	Node.NodeIndex = NodeIndex;
+	return Node;
+}
+
+int32 UBCustomTreeView::ResolveNodeHandle(const FBTreeNodeHandle& Node) const
+{
+	// Indices of removed nodes are reused, so the index is only trusted while it still holds the same key.
+	if (NodeStore->IsValidNode(Node.NodeIndex) && NodeStore->GetKey(Node.NodeIndex) == Node.NodeID)
+	{
+		return Node.NodeIndex;
+	}
+	return NodeStore->FindNode(Node.NodeID);
+}
+
+void UBCustomTreeView::MakeTreeNode(int32 NodeIndex, FBTreeNode& OutNode) const
+{
+	OutNode.NodeID = NodeStore->GetKey(NodeIndex);
+	OutNode.NodeName = NodeStore->GetName(NodeIndex);
+	OutNode.ParentID = GetParentNodeID(NodeIndex);
+	OutNode.NodePadding = NodeStore->GetPadding(NodeIndex);
+	OutNode.HasLazyChildren = (NodeStore->GetFlags(NodeIndex) & EBTreeNodeFlags::LazyChildren) != 0;
+	if (NodeStore->HasDirectoryPaths())
+	{
+		OutNode.DirectoryPath = NodeStore->GetDirectoryPath(NodeIndex);
+	}
+	NodeStore->GetExtraStrings(NodeIndex, OutNode.ExtraStrings);
+}
+
+void UBCustomTreeView::MakeTreeNodeChildren(int32 NodeIndex, TArray<FBTreeNode>& OutChildren) const
+{
+	OutChildren.Reserve(NodeStore->GetNumChildren(NodeIndex));
+	for (int32 Child = NodeStore->GetFirstChild(NodeIndex); Child != INDEX_NONE; Child = NodeStore->GetNextSibling(Child))
+	{
+		MakeTreeNode(Child, OutChildren.AddDefaulted_GetRef());
+	}
+}
+
+void UBCustomTreeView::HandleOnGenerateRow(TreeNodePtr Item, class UUserWidget* RowWidget)
+{
+	if (Item.IsValid() && Item->IsValidNode())
+	{
+		OnGenerateNodeRow.Broadcast(MakeNodeHandle(Item->GetNodeIndex()), RowWidget);
+
+		if (UseLegacyNodeEvents && OnGenerateRow.IsBound())
+		{
+			FBTreeNode Node;
+			MakeTreeNode(Item->GetNodeIndex(), Node);
+
+			TArray<FBTreeNode> NodeChildren;
+			MakeTreeNodeChildren(Item->GetNodeIndex(), NodeChildren);
+
+			OnGenerateRow.Broadcast(Node, RowWidget, NodeChildren);
+		}
+	}
+}
+
+void UBCustomTreeView::HandleOnRowRebind(TreeNodePtr Item, class UUserWidget* RowWidget)
+{
+	if (Item.IsValid() && Item->IsValidNode())
+	{
+		OnNodeRowRebind.Broadcast(MakeNodeHandle(Item->GetNodeIndex()), RowWidget);
+
+		if (UseLegacyNodeEvents && OnRowRebind.IsBound())
+		{
+			FBTreeNode Node;
+			MakeTreeNode(Item->GetNodeIndex(), Node);
+
+			TArray<FBTreeNode> NodeChildren;
+			MakeTreeNodeChildren(Item->GetNodeIndex(), NodeChildren);
+
+			OnRowRebind.Broadcast(Node, RowWidget, NodeChildren);
+		}
+	}
+}
+
+void UBCustomTreeView::HandleOnSelectionChanged(TreeNodePtr Item, class UUserWidget* RowWidget)
+{
+	if (Item.IsValid() && Item->IsValidNode())
+	{
+		OnNodeSelectionChanged.Broadcast(MakeNodeHandle(Item->GetNodeIndex()), RowWidget);
+
+		if (UseLegacyNodeEvents && OnSelectionChanged.IsBound())
+		{
+			FBTreeNode node;
+			MakeTreeNode(Item->GetNodeIndex(), node);
+			OnSelectionChanged.Broadcast(node, RowWidget);
+		}
+	}
+}
+
+void UBCustomTreeView::HandleOnSelectionLost()
+{
+	OnSelectionLost.Broadcast();
+}
+
+void UBCustomTreeView::HandleOnSelectionDelta(const FBSelectionDelta& Delta)
+{
+	if (!OnSelectionSetChanged.IsBound())
+	{
+		return;
+	}
+
+	FBTreeSelectionDelta SelectionDelta;
+	SelectionDelta.SelectedNodeIDs.Reserve(Delta.SelectedNodes.Num());
+	for (int32 NodeIndex : Delta.SelectedNodes)
+	{
+		SelectionDelta.SelectedNodeIDs.Add(NodeStore->GetKey(NodeIndex));
+	}
+	SelectionDelta.DeselectedNodeIDs.Reserve(Delta.DeselectedNodes.Num());
+	for (int32 NodeIndex : Delta.DeselectedNodes)
+	{
+		// Deselected nodes may have been removed since, their key is gone with them.
+		if (NodeStore->IsValidNode(NodeIndex))
+		{
+			SelectionDelta.DeselectedNodeIDs.Add(NodeStore->GetKey(NodeIndex));
+		}
+	}
+	SelectionDelta.NumSelected = TreeViewWidget.IsValid() ? TreeViewWidget->GetNumSelectedNodes() : 0;
+	OnSelectionSetChanged.Broadcast(SelectionDelta);
+}
+
+void UBCustomTreeView::HandleOnExpansionChanged(TreeNodePtr Item, class UUserWidget* RowWidget, bool ExpansionState)
+{
+	if (Item.IsValid() && Item->IsValidNode())
+	{
+		OnNodeExpansionChanged.Broadcast(MakeNodeHandle(Item->GetNodeIndex()), RowWidget, ExpansionState);
+
+		if (UseLegacyNodeEvents && OnExpansionChanged.IsBound())
+		{
+			FBTreeNode node;
+			MakeTreeNode(Item->GetNodeIndex(), node);
+			OnExpansionChanged.Broadcast(node, RowWidget, ExpansionState);
+		}
 	}
 }
 
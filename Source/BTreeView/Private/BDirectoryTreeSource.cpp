@@ -0,0 +1,182 @@
+/// MIT License, Copyright Burak Kara, burak@burak.io, https://en.wikipedia.org/wiki/MIT_License
+
+#include "BDirectoryTreeSource.h"
+#include "Async/Async.h"
+#include "HAL/FileManager.h"
+#include "Hash/CityHash.h"
+#include "Misc/Paths.h"
+
+#if WITH_EDITOR
+#include "DirectoryWatcherModule.h"
+#include "IDirectoryWatcher.h"
+#include "Modules/ModuleManager.h"
+#endif
+
+/** Entries of a batch at most, the game thread checking its time budget between batches */
+static const int32 MaxBatchSize = 256;
+
+FBDirectoryTreeSource::FBDirectoryTreeSource(const FString& InRootPath, bool bInIncludeFiles)
+	: RootPath(NormalizePath(InRootPath))
+	, State(MakeShared<FScanState, ESPMode::ThreadSafe>())
+{
+	State->bIncludeFiles = bInIncludeFiles;
+}
+
+FBDirectoryTreeSource::~FBDirectoryTreeSource()
+{
+	// Running tasks keep the state alive and stop at their next directory.
+	State->bCancelled = true;
+
+#if WITH_EDITOR
+	if (WatcherHandle.IsValid())
+	{
+		FDirectoryWatcherModule* DirectoryWatcherModule = FModuleManager::GetModulePtr<FDirectoryWatcherModule>(TEXT("DirectoryWatcher"));
+		if (DirectoryWatcherModule && DirectoryWatcherModule->Get())
+		{
+			DirectoryWatcherModule->Get()->UnregisterDirectoryChangedCallback_Handle(RootPath, WatcherHandle);
+		}
+	}
+#endif
+}
+
+void FBDirectoryTreeSource::Start(bool bWatchChanges)
+{
+	ScanDirectoryAsync(State, RootPath, MakeKey(RootPath));
+
+#if WITH_EDITOR
+	if (bWatchChanges)
+	{
+		FDirectoryWatcherModule& DirectoryWatcherModule = FModuleManager::LoadModuleChecked<FDirectoryWatcherModule>(TEXT("DirectoryWatcher"));
+		if (DirectoryWatcherModule.Get())
+		{
+			DirectoryWatcherModule.Get()->RegisterDirectoryChangedCallback_Handle(RootPath,
+				IDirectoryWatcher::FDirectoryChanged::CreateRaw(this, &FBDirectoryTreeSource::OnDirectoryChanged),
+				WatcherHandle, IDirectoryWatcher::WatchOptions::IncludeDirectoryChanges);
+		}
+	}
+#endif
+}
+
+bool FBDirectoryTreeSource::DequeueBatch(TArray<FBDirectoryEntry>& OutBatch)
+{
+	return State->Batches.Dequeue(OutBatch);
+}
+
+bool FBDirectoryTreeSource::IsScanComplete() const
+{
+	// Tasks queue their batch before they are done, so no task left means every batch is queued.
+	return State->PendingTasks.GetValue() == 0 && State->Batches.IsEmpty();
+}
+
+bool FBDirectoryTreeSource::IsWatching() const
+{
+#if WITH_EDITOR
+	return WatcherHandle.IsValid();
+#else
+	return false;
+#endif
+}
+
+int64 FBDirectoryTreeSource::MakeKey(const FString& Path)
+{
+	const FString LowerPath = Path.ToLower();
+	const int64 Key = (int64)CityHash64((const char*)*LowerPath, LowerPath.Len() * sizeof(TCHAR));
+	return Key != 0 ? Key : 1;
+}
+
+FString FBDirectoryTreeSource::NormalizePath(const FString& Path)
+{
+	FString FullPath = FPaths::ConvertRelativePathToFull(Path);
+	FPaths::NormalizeDirectoryName(FullPath);
+	return FullPath;
+}
+
+void FBDirectoryTreeSource::ScanDirectoryAsync(const TSharedRef<FScanState, ESPMode::ThreadSafe>& ScanState, const FString& Path, int64 Key)
+{
+	ScanState->PendingTasks.Increment();
+	Async(EAsyncExecution::ThreadPool, [ScanState, Path, Key]()
+	{
+		ScanDirectory(ScanState, Path, Key);
+	});
+}
+
+void FBDirectoryTreeSource::EnqueueBatches(FScanState& ScanState, const TArray<FBDirectoryEntry>& Entries)
+{
+	for (int32 First = 0; First < Entries.Num(); First += MaxBatchSize)
+	{
+		const int32 Num = FMath::Min(MaxBatchSize, Entries.Num() - First);
+		ScanState.Batches.Enqueue(TArray<FBDirectoryEntry>(Entries.GetData() + First, Num));
+	}
+}
+
+void FBDirectoryTreeSource::ScanDirectory(const TSharedRef<FScanState, ESPMode::ThreadSafe>& ScanState, const FString& Path, int64 Key)
+{
+	if (!ScanState->bCancelled)
+	{
+		TArray<FBDirectoryEntry> Batch;
+		TArray<FString> SubDirectories;
+		IFileManager::Get().IterateDirectory(*Path, [&ScanState, &Batch, &SubDirectories, Key](const TCHAR* FilenameOrDirectory, bool bIsDirectory)
+		{
+			if (bIsDirectory || ScanState->bIncludeFiles)
+			{
+				const FString EntryPath = FilenameOrDirectory;
+				Batch.Add({ MakeKey(EntryPath), Key, FPaths::GetCleanFilename(EntryPath), bIsDirectory, false });
+				if (bIsDirectory)
+				{
+					SubDirectories.Add(EntryPath);
+				}
+			}
+			return true;
+		});
+
+		// Directories first, then files, each by name.
+		Batch.Sort([](const FBDirectoryEntry& A, const FBDirectoryEntry& B)
+		{
+			return A.bDirectory != B.bDirectory ? A.bDirectory : A.Name < B.Name;
+		});
+		EnqueueBatches(*ScanState, Batch);
+
+		// The batches are queued before the subdirectories are scanned, so parents always arrive first.
+		for (const FString& SubDirectory : SubDirectories)
+		{
+			ScanDirectoryAsync(ScanState, SubDirectory, MakeKey(SubDirectory));
+		}
+	}
+
+	ScanState->PendingTasks.Decrement();
+}
+
+#if WITH_EDITOR
+void FBDirectoryTreeSource::OnDirectoryChanged(const TArray<FFileChangeData>& Changes)
+{
+	TArray<FBDirectoryEntry> Batch;
+	TArray<FString> AddedDirectories;
+	for (const FFileChangeData& Change : Changes)
+	{
+		const FString Path = NormalizePath(Change.Filename);
+		if (Change.Action == FFileChangeData::FCA_Removed)
+		{
+			Batch.Add({ MakeKey(Path), 0, FString(), false, true });
+		}
+		else if (Change.Action == FFileChangeData::FCA_Added)
+		{
+			const bool bDirectory = IFileManager::Get().DirectoryExists(*Path);
+			if (bDirectory || State->bIncludeFiles)
+			{
+				Batch.Add({ MakeKey(Path), MakeKey(FPaths::GetPath(Path)), FPaths::GetCleanFilename(Path), bDirectory, false });
+			}
+			// A directory moved in may already have contents.
+			if (bDirectory)
+			{
+				AddedDirectories.Add(Path);
+			}
+		}
+	}
+
+	EnqueueBatches(*State, Batch);
+	for (const FString& AddedDirectory : AddedDirectories)
+	{
+		ScanDirectoryAsync(State, AddedDirectory, MakeKey(AddedDirectory));
+	}
+}
+#endif
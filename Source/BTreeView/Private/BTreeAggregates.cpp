@@ -0,0 +1,235 @@
+/// MIT License, Copyright Burak Kara, burak@burak.io, https://en.wikipedia.org/wiki/MIT_License
+
+#include "BTreeAggregates.h"
+#include "BTreeNodeStore.h"
+
+FBTreeAggregates::FBTreeAggregates(const TArray<FAggregate>& InAggregates)
+{
+	Aggregates.SetNum(InAggregates.Num());
+	for (int32 AggregateIndex = 0; AggregateIndex < InAggregates.Num(); AggregateIndex++)
+	{
+		Aggregates[AggregateIndex].Aggregate = InAggregates[AggregateIndex];
+	}
+}
+
+void FBTreeAggregates::Build(const FBTreeNodeStore& Store)
+{
+	for (FValues& Values : Aggregates)
+	{
+		const double Identity = GetIdentity(Values.Aggregate.Operation);
+		Values.Own.Init(Identity, Store.Num());
+		Values.Subtree.Init(Identity, Store.Num());
+	}
+
+	// Walks down to first children and along next siblings, climbing back through the parents. A node is
+	// complete when the walk leaves it, and is combined into its parent then.
+	int32 Node = Store.GetFirstRoot();
+	while (Node != INDEX_NONE)
+	{
+		for (FValues& Values : Aggregates)
+		{
+			Values.Own[Node] = GetOwnValue(Values, Store, Node);
+			Values.Subtree[Node] = Values.Own[Node];
+		}
+
+		if (Store.GetFirstChild(Node) != INDEX_NONE)
+		{
+			Node = Store.GetFirstChild(Node);
+			continue;
+		}
+		while (Node != INDEX_NONE)
+		{
+			const int32 Parent = Store.GetParent(Node);
+			if (Parent != INDEX_NONE)
+			{
+				for (FValues& Values : Aggregates)
+				{
+					Values.Subtree[Parent] = Combine(Values.Aggregate.Operation, Values.Subtree[Parent], Values.Subtree[Node]);
+				}
+			}
+			if (Store.GetNextSibling(Node) != INDEX_NONE)
+			{
+				Node = Store.GetNextSibling(Node);
+				break;
+			}
+			Node = Parent;
+		}
+	}
+}
+
+void FBTreeAggregates::AddNode(const FBTreeNodeStore& Store, int32 NodeIndex)
+{
+	for (FValues& Values : Aggregates)
+	{
+		// Indices between the last built one and this node are set when their nodes are added.
+		if (Values.Own.Num() < Store.Num())
+		{
+			Values.Own.SetNumZeroed(Store.Num());
+			Values.Subtree.SetNumZeroed(Store.Num());
+		}
+		Values.Own[NodeIndex] = GetOwnValue(Values, Store, NodeIndex);
+		Values.Subtree[NodeIndex] = Values.Own[NodeIndex];
+		AddToPath(Values, Store, Store.GetParent(NodeIndex), Values.Subtree[NodeIndex]);
+	}
+}
+
+void FBTreeAggregates::LinkSubtree(const FBTreeNodeStore& Store, int32 NodeIndex)
+{
+	for (FValues& Values : Aggregates)
+	{
+		AddToPath(Values, Store, Store.GetParent(NodeIndex), Values.Subtree[NodeIndex]);
+	}
+}
+
+void FBTreeAggregates::UnlinkSubtree(const FBTreeNodeStore& Store, int32 NodeIndex)
+{
+	const int32 Parent = Store.GetParent(NodeIndex);
+	if (Parent == INDEX_NONE)
+	{
+		return;
+	}
+
+	for (FValues& Values : Aggregates)
+	{
+		const EOperation Operation = Values.Aggregate.Operation;
+		if (Operation == EOperation::Count || Operation == EOperation::Sum)
+		{
+			AddToPath(Values, Store, Parent, -Values.Subtree[NodeIndex]);
+		}
+		else if (Values.Subtree[NodeIndex] == Values.Subtree[Parent])
+		{
+			UpdateExtremes(Values, Store, Parent, NodeIndex);
+		}
+	}
+}
+
+void FBTreeAggregates::UpdateNode(const FBTreeNodeStore& Store, int32 NodeIndex)
+{
+	for (FValues& Values : Aggregates)
+	{
+		const double OldValue = Values.Own[NodeIndex];
+		Values.Own[NodeIndex] = GetOwnValue(Values, Store, NodeIndex);
+
+		const EOperation Operation = Values.Aggregate.Operation;
+		if (Operation == EOperation::Count || Operation == EOperation::Sum)
+		{
+			AddToPath(Values, Store, NodeIndex, Values.Own[NodeIndex] - OldValue);
+		}
+		else if (Values.Own[NodeIndex] != OldValue)
+		{
+			UpdateExtremes(Values, Store, NodeIndex, INDEX_NONE);
+		}
+	}
+}
+
+double FBTreeAggregates::GetValue(int32 AggregateIndex, int32 NodeIndex) const
+{
+	const FValues& Values = Aggregates[AggregateIndex];
+	const double Value = Values.Subtree[NodeIndex];
+	if (Values.Aggregate.Operation == EOperation::Count)
+	{
+		return Value - 1.0;
+	}
+	return Value != GetIdentity(Values.Aggregate.Operation) ? Value : 0.0;
+}
+
+double FBTreeAggregates::Combine(EOperation Operation, double A, double B)
+{
+	switch (Operation)
+	{
+	case EOperation::Min:
+		return FMath::Min(A, B);
+	case EOperation::Max:
+		return FMath::Max(A, B);
+	default:
+		return A + B;
+	}
+}
+
+double FBTreeAggregates::GetIdentity(EOperation Operation)
+{
+	switch (Operation)
+	{
+	case EOperation::Min:
+		return TNumericLimits<double>::Max();
+	case EOperation::Max:
+		return TNumericLimits<double>::Lowest();
+	default:
+		return 0.0;
+	}
+}
+
+double FBTreeAggregates::GetOwnValue(const FValues& Values, const FBTreeNodeStore& Store, int32 NodeIndex) const
+{
+	if (Values.Aggregate.Operation == EOperation::Count)
+	{
+		return 1.0;
+	}
+
+	const int32 StringIndex = Values.Aggregate.ExtraStringIndex;
+	if (StringIndex >= 0 && StringIndex < Store.GetNumExtraStrings(NodeIndex))
+	{
+		const TCHAR* String = Store.GetExtraString(NodeIndex, StringIndex);
+		if (*String && FCString::IsNumeric(String))
+		{
+			return FCString::Atod(String);
+		}
+	}
+	return GetIdentity(Values.Aggregate.Operation);
+}
+
+void FBTreeAggregates::AddToPath(FValues& Values, const FBTreeNodeStore& Store, int32 NodeIndex, double Value) const
+{
+	// An ancestor keeping its least or greatest value keeps it above too, but a rounded sum left unchanged by a small
+	// value may still be changed higher up, so sums are added all the way to the root.
+	const EOperation Operation = Values.Aggregate.Operation;
+	const bool bExtreme = Operation == EOperation::Min || Operation == EOperation::Max;
+	if (!bExtreme && Value == 0.0)
+	{
+		return;
+	}
+
+	for (; NodeIndex != INDEX_NONE; NodeIndex = Store.GetParent(NodeIndex))
+	{
+		const double Combined = Combine(Operation, Values.Subtree[NodeIndex], Value);
+		if (bExtreme && Combined == Values.Subtree[NodeIndex])
+		{
+			break;
+		}
+		Values.Subtree[NodeIndex] = Combined;
+	}
+}
+
+double FBTreeAggregates::CombineChildren(const FValues& Values, const FBTreeNodeStore& Store, int32 NodeIndex, int32 ExcludedChild) const
+{
+	double Value = Values.Own[NodeIndex];
+	for (int32 Child = Store.GetFirstChild(NodeIndex); Child != INDEX_NONE; Child = Store.GetNextSibling(Child))
+	{
+		if (Child != ExcludedChild)
+		{
+			Value = Combine(Values.Aggregate.Operation, Value, Values.Subtree[Child]);
+		}
+	}
+	return Value;
+}
+
+void FBTreeAggregates::UpdateExtremes(FValues& Values, const FBTreeNodeStore& Store, int32 NodeIndex, int32 ExcludedChild) const
+{
+	double OldValue = Values.Subtree[NodeIndex];
+	double NewValue = CombineChildren(Values, Store, NodeIndex, ExcludedChild);
+	while (NewValue != OldValue)
+	{
+		Values.Subtree[NodeIndex] = NewValue;
+		NodeIndex = Store.GetParent(NodeIndex);
+		if (NodeIndex == INDEX_NONE)
+		{
+			break;
+		}
+
+		// A child that got past the value of its parent gives it its value, a child that held it makes it read all the children.
+		const double ParentValue = Values.Subtree[NodeIndex];
+		const double Combined = Combine(Values.Aggregate.Operation, ParentValue, NewValue);
+		NewValue = Combined != ParentValue || OldValue != ParentValue ? Combined : CombineChildren(Values, Store, NodeIndex, INDEX_NONE);
+		OldValue = ParentValue;
+	}
+}
@@ -0,0 +1,54 @@
+/// MIT License, Copyright Burak Kara, burak@burak.io, https://en.wikipedia.org/wiki/MIT_License
+
+#include "BTreeDragDropOp.h"
+#include "BTreeNodeStore.h"
+#include "Widgets/Layout/SBorder.h"
+#include "Widgets/Text/STextBlock.h"
+#include "Styling/CoreStyle.h"
+
+TSharedRef<FBTreeDragDropOp> FBTreeDragDropOp::New(const FBTreeNodeStore& Store, const TArray<int32>& InNodes)
+{
+	TSharedRef<FBTreeDragDropOp> Operation = MakeShared<FBTreeDragDropOp>();
+	Operation->Store = &Store;
+
+	// In depth-first order, the nodes under a dragged node follow it, before the next node that is not under it.
+	// They are left out, and the others keep the order they are shown in.
+	TArray<int32> SortedNodes = InNodes;
+	SortedNodes.Sort([&Store](int32 A, int32 B)
+	{
+		return Store.GetPreorderPosition(A) < Store.GetPreorderPosition(B);
+	});
+	for (int32 NodeIndex : SortedNodes)
+	{
+		if (Operation->Nodes.Num() == 0 || !Store.IsAncestor(Operation->Nodes.Last(), NodeIndex))
+		{
+			Operation->Nodes.Add(NodeIndex);
+		}
+	}
+
+	Operation->DraggedSubtrees.Init(false, Store.Num());
+	for (int32 NodeIndex : Operation->Nodes)
+	{
+		for (int32 Descendant : Store.GetSubtree(NodeIndex))
+		{
+			Operation->DraggedSubtrees[Descendant] = true;
+		}
+	}
+
+	Operation->Label = Operation->Nodes.Num() == 1
+		? FText::FromString(Store.GetName(Operation->Nodes[0]))
+		: FText::Format(NSLOCTEXT("BTreeView", "DraggedNodes", "{0} nodes"), FText::AsNumber(Operation->Nodes.Num()));
+
+	Operation->Construct();
+	return Operation;
+}
+
+TSharedPtr<SWidget> FBTreeDragDropOp::GetDefaultDecorator() const
+{
+	return SNew(SBorder)
+		.BorderImage(FCoreStyle::Get().GetBrush("ToolPanel.GroupBorder"))
+		.Padding(FMargin(6.0f, 3.0f))
+		[
+			SNew(STextBlock).Text(Label)
+		];
+}
@@ -0,0 +1,113 @@
+/// MIT License, Copyright Burak Kara, burak@burak.io, https://en.wikipedia.org/wiki/MIT_License
+
+#include "BTreeFilter.h"
+#include "BTreeNodeStore.h"
+#include "Algo/BinarySearch.h"
+#include "Async/Async.h"
+#include "Async/ParallelFor.h"
+
+/** Number of candidate nodes matched by each parallel task */
+static const int32 NodesPerFilterChunk = 2048;
+
+const FBTreeNodeMatch* FBTreeFilterResult::FindMatch(int32 NodeIndex) const
+{
+	const int32 MatchIndex = Algo::BinarySearchBy(Matches, NodeIndex, [](const FBTreeNodeMatch& Match)
+	{
+		return Match.NodeIndex;
+	});
+	return MatchIndex != INDEX_NONE ? &Matches[MatchIndex] : nullptr;
+}
+
+TFuture<FBTreeFilterResultPtr> FBTreeFilter::FilterAsync(const FBTreeNodeStore& Store, const FString& Text, bool bMatchExtraStrings, const FBTreeFilterResultPtr& Previous)
+{
+	const FBTreeNodeStore* StorePtr = &Store;
+	return Async(EAsyncExecution::ThreadPool, [StorePtr, Text, bMatchExtraStrings, Previous]()
+	{
+		return Filter(*StorePtr, Text, bMatchExtraStrings, Previous);
+	});
+}
+
+bool FBTreeFilter::MatchNode(const FBTreeNodeStore& Store, int32 NodeIndex, const FString& Text, bool bMatchExtraStrings, FBTreeNodeMatch& OutMatch)
+{
+	OutMatch.NodeIndex = NodeIndex;
+
+	const TCHAR* Name = Store.GetName(NodeIndex);
+	if (const TCHAR* Found = FCString::Stristr(Name, *Text))
+	{
+		OutMatch.StringIndex = INDEX_NONE;
+		OutMatch.Start = Found - Name;
+		return true;
+	}
+
+	if (bMatchExtraStrings)
+	{
+		const int32 NumExtraStrings = Store.GetNumExtraStrings(NodeIndex);
+		for (int32 StringIndex = 0; StringIndex < NumExtraStrings; StringIndex++)
+		{
+			const TCHAR* ExtraString = Store.GetExtraString(NodeIndex, StringIndex);
+			if (const TCHAR* Found = FCString::Stristr(ExtraString, *Text))
+			{
+				OutMatch.StringIndex = StringIndex;
+				OutMatch.Start = Found - ExtraString;
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+FBTreeFilterResultPtr FBTreeFilter::Filter(const FBTreeNodeStore& Store, const FString& Text, bool bMatchExtraStrings, const FBTreeFilterResultPtr& Previous)
+{
+	FBTreeFilterResultPtr Result = MakeShared<FBTreeFilterResult, ESPMode::ThreadSafe>();
+	Result->Text = Text;
+	Result->bMatchExtraStrings = bMatchExtraStrings;
+
+	// A narrower query can only match what the previous one matched.
+	const bool bNarrowing = Previous.IsValid() && Previous->bMatchExtraStrings == bMatchExtraStrings && Text.Contains(Previous->Text);
+	const int32 NumCandidates = bNarrowing ? Previous->Matches.Num() : Store.Num();
+
+	// Every chunk collects its own matches, which are joined in chunk order and so stay sorted by node index.
+	const int32 NumChunks = FMath::DivideAndRoundUp(NumCandidates, NodesPerFilterChunk);
+	TArray< TArray<FBTreeNodeMatch> > ChunkMatches;
+	ChunkMatches.SetNum(NumChunks);
+	ParallelFor(NumChunks, [&Store, &Text, bMatchExtraStrings, &Previous, bNarrowing, NumCandidates, &ChunkMatches](int32 Chunk)
+	{
+		const int32 ChunkEnd = FMath::Min((Chunk + 1) * NodesPerFilterChunk, NumCandidates);
+		FBTreeNodeMatch Match;
+		for (int32 Candidate = Chunk * NodesPerFilterChunk; Candidate < ChunkEnd; Candidate++)
+		{
+			const int32 NodeIndex = bNarrowing ? Previous->Matches[Candidate].NodeIndex : Candidate;
+			if (Store.IsValidNode(NodeIndex) && MatchNode(Store, NodeIndex, Text, bMatchExtraStrings, Match))
+			{
+				ChunkMatches[Chunk].Add(Match);
+			}
+		}
+	});
+
+	int32 NumMatches = 0;
+	for (const TArray<FBTreeNodeMatch>& Matches : ChunkMatches)
+	{
+		NumMatches += Matches.Num();
+	}
+	Result->Matches.Reserve(NumMatches);
+	for (const TArray<FBTreeNodeMatch>& Matches : ChunkMatches)
+	{
+		Result->Matches.Append(Matches);
+	}
+
+	// Walk up from every match, stopping at the first ancestor another match already reached.
+	TBitArray<> AncestorNodes(false, Store.Num());
+	Result->VisibleNodes.Init(false, Store.Num());
+	for (const FBTreeNodeMatch& Match : Result->Matches)
+	{
+		Result->VisibleNodes[Match.NodeIndex] = true;
+		for (int32 Parent = Store.GetParent(Match.NodeIndex); Parent != INDEX_NONE && !AncestorNodes[Parent]; Parent = Store.GetParent(Parent))
+		{
+			AncestorNodes[Parent] = true;
+			Result->VisibleNodes[Parent] = true;
+			Result->Ancestors.Add(Parent);
+		}
+	}
+
+	return Result;
+}
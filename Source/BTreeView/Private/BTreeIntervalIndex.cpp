@@ -0,0 +1,105 @@
+/// MIT License, Copyright Burak Kara, burak@burak.io, https://en.wikipedia.org/wiki/MIT_License
+
+#include "BTreeIntervalIndex.h"
+#include "BTreeNodeStore.h"
+#include "Algo/BinarySearch.h"
+
+void FBTreeIntervalIndex::Reset()
+{
+	Order.Reset();
+	Positions.Reset();
+	SubtreeSizes.Reset();
+	RootPositions.Reset();
+	DepthTree.Reset();
+}
+
+void FBTreeIntervalIndex::Build(const FBTreeNodeStore& Store)
+{
+	Reset();
+	Order.Reserve(Store.NumNodes());
+	Positions.Init(INDEX_NONE, Store.Num());
+	SubtreeSizes.Init(0, Store.Num());
+
+	// Walks down to first children and along next siblings, climbing back through the parents. A node is
+	// finished when the walk leaves it, every one of its descendants having been numbered by then.
+	int32 Node = Store.GetFirstRoot();
+	while (Node != INDEX_NONE)
+	{
+		Positions[Node] = Order.Add(Node);
+		if (Store.GetParent(Node) == INDEX_NONE)
+		{
+			RootPositions.Add(Positions[Node]);
+		}
+
+		if (Store.GetFirstChild(Node) != INDEX_NONE)
+		{
+			Node = Store.GetFirstChild(Node);
+			continue;
+		}
+		while (Node != INDEX_NONE)
+		{
+			SubtreeSizes[Node] = Order.Num() - Positions[Node];
+			if (Store.GetNextSibling(Node) != INDEX_NONE)
+			{
+				Node = Store.GetNextSibling(Node);
+				break;
+			}
+			Node = Store.GetParent(Node);
+		}
+	}
+
+	const int32 NumLeaves = Order.Num();
+	DepthTree.SetNumUninitialized(NumLeaves * 2);
+	for (int32 Position = 0; Position < NumLeaves; Position++)
+	{
+		DepthTree[NumLeaves + Position] = ((int64)Store.GetDepth(Order[Position]) << 32) | Position;
+	}
+	for (int32 Entry = NumLeaves - 1; Entry > 0; Entry--)
+	{
+		DepthTree[Entry] = FMath::Min(DepthTree[Entry * 2], DepthTree[Entry * 2 + 1]);
+	}
+}
+
+int32 FBTreeIntervalIndex::GetRoot(int32 NodeIndex) const
+{
+	// The root of a node is the last root numbered at or before it.
+	const int32 RootSlot = Algo::UpperBound(RootPositions, Positions[NodeIndex]) - 1;
+	return Order[RootPositions[RootSlot]];
+}
+
+int32 FBTreeIntervalIndex::FindCommonAncestor(const FBTreeNodeStore& Store, int32 A, int32 B) const
+{
+	if (IsAncestor(A, B))
+	{
+		return A;
+	}
+	if (IsAncestor(B, A))
+	{
+		return B;
+	}
+
+	// Between the two nodes, the shallowest node is the child of their common ancestor whose subtree
+	// holds the later one, or a root if they have no common ancestor.
+	const int32 NumLeaves = Order.Num();
+	int32 Low = FMath::Min(Positions[A], Positions[B]) + 1 + NumLeaves;
+	int32 High = FMath::Max(Positions[A], Positions[B]) + 1 + NumLeaves;
+	int64 Shallowest = MAX_int64;
+	for (; Low < High; Low /= 2, High /= 2)
+	{
+		if (Low & 1)
+		{
+			Shallowest = FMath::Min(Shallowest, DepthTree[Low++]);
+		}
+		if (High & 1)
+		{
+			Shallowest = FMath::Min(Shallowest, DepthTree[--High]);
+		}
+	}
+	return Store.GetParent(Order[(int32)(Shallowest & MAX_uint32)]);
+}
+
+SIZE_T FBTreeIntervalIndex::GetAllocatedSize() const
+{
+	return Order.GetAllocatedSize() + Positions.GetAllocatedSize() + SubtreeSizes.GetAllocatedSize()
+		+ RootPositions.GetAllocatedSize() + DepthTree.GetAllocatedSize();
+}
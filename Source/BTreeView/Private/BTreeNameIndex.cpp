@@ -0,0 +1,332 @@
+/// MIT License, Copyright Burak Kara, burak@burak.io, https://en.wikipedia.org/wiki/MIT_License
+
+#include "BTreeNameIndex.h"
+#include "BTreeNodeStore.h"
+
+/** Score of a query character matched at the start of a word */
+static const int32 WordStartBonus = 8;
+
+/** Score added per preceding consecutive match */
+static const int32 StreakBonus = 4;
+
+/** Score lost per name character skipped between two matches, and at most before the first one */
+static const int32 GapPenalty = 1;
+static const int32 MaxLeadingPenalty = 8;
+
+/** Score added to names containing the query as a whole, which ranks them before the scattered matches */
+static const int32 ContainsBonus = 1000;
+
+/** Stale trigram and character entries tolerated before the index is rebuilt */
+static const int32 MinStaleEntries = 4096;
+
+/** Bit set in the character mask of every indexed node, so that no indexed node has a mask of 0 */
+static const uint64 IndexedNodeBit = 1ull << 63;
+
+FBTreeNameIndex::FBTreeNameIndex(const FBTreeNodeStore& InStore)
+	: Store(InStore)
+	, NumEntries(0)
+	, NumStaleEntries(0)
+{
+}
+
+void FBTreeNameIndex::Reset()
+{
+	Trigrams.Empty();
+	for (TArray<int32>& Nodes : CharNodes)
+	{
+		Nodes.Empty();
+	}
+	CharMasks.Empty();
+	NumNodeEntries.Empty();
+	NumEntries = 0;
+	NumStaleEntries = 0;
+}
+
+void FBTreeNameIndex::Build()
+{
+	Reset();
+	CharMasks.SetNumZeroed(Store.Num());
+	NumNodeEntries.SetNumZeroed(Store.Num());
+	for (int32 NodeIndex = 0; NodeIndex < Store.Num(); NodeIndex++)
+	{
+		if (Store.IsValidNode(NodeIndex))
+		{
+			AddNode(NodeIndex);
+		}
+	}
+}
+
+int32 FBTreeNameIndex::GetCharBit(TCHAR Char)
+{
+	const TCHAR Lower = FChar::ToLower(Char);
+	if (Lower >= TEXT('a') && Lower <= TEXT('z'))
+	{
+		return Lower - TEXT('a');
+	}
+	if (Lower >= TEXT('0') && Lower <= TEXT('9'))
+	{
+		return 26 + Lower - TEXT('0');
+	}
+	return 36 + (uint32)Lower % 27;
+}
+
+uint64 FBTreeNameIndex::MakeCharMask(const TCHAR* String)
+{
+	uint64 Mask = IndexedNodeBit;
+	for (const TCHAR* Char = String; *Char; ++Char)
+	{
+		Mask |= 1ull << GetCharBit(*Char);
+	}
+	return Mask;
+}
+
+void FBTreeNameIndex::AddNode(int32 NodeIndex)
+{
+	if (NodeIndex >= CharMasks.Num())
+	{
+		CharMasks.AddZeroed(NodeIndex + 1 - CharMasks.Num());
+		NumNodeEntries.AddZeroed(NodeIndex + 1 - NumNodeEntries.Num());
+	}
+
+	const TCHAR* Name = Store.GetName(NodeIndex);
+	CharMasks[NodeIndex] = MakeCharMask(Name);
+
+	int32 NumAdded = 0;
+	for (int32 Bit = 0; Bit < NumCharBits; Bit++)
+	{
+		if (CharMasks[NodeIndex] & (1ull << Bit))
+		{
+			CharNodes[Bit].Add(NodeIndex);
+			NumAdded++;
+		}
+	}
+
+	TArray<TCHAR, TInlineAllocator<128>> LowerName;
+	for (const TCHAR* Char = Name; *Char; ++Char)
+	{
+		LowerName.Add(FChar::ToLower(*Char));
+	}
+
+	for (int32 i = 0; i + 3 <= LowerName.Num(); i++)
+	{
+		TArray<int32>& Nodes = Trigrams.FindOrAdd(MakeTrigram(&LowerName[i]));
+
+		// Only this node is added meanwhile, so a trigram repeated in the name ends with it already.
+		if (Nodes.Num() == 0 || Nodes.Last() != NodeIndex)
+		{
+			Nodes.Add(NodeIndex);
+			NumAdded++;
+		}
+	}
+	NumNodeEntries[NodeIndex] = NumAdded;
+	NumEntries += NumAdded;
+}
+
+void FBTreeNameIndex::RemoveNode(int32 NodeIndex)
+{
+	if (!CharMasks.IsValidIndex(NodeIndex) || CharMasks[NodeIndex] == 0)
+	{
+		return;
+	}
+
+	CharMasks[NodeIndex] = 0;
+	NumStaleEntries += NumNodeEntries[NodeIndex];
+	NumNodeEntries[NodeIndex] = 0;
+
+	// The entries are left in place, queries check every candidate against its current mask and name anyway.
+	if (NumStaleEntries > MinStaleEntries && NumStaleEntries > NumEntries / 2)
+	{
+		Build();
+	}
+}
+
+int32 FBTreeNameIndex::ScoreName(const TCHAR* Name, const FString& LowerQuery)
+{
+	const int32 QueryLen = LowerQuery.Len();
+	int32 QueryPos = 0;
+	int32 Score = 0;
+	int32 Streak = 0;
+	int32 FirstMatch = INDEX_NONE;
+	int32 NameLen = 0;
+	TCHAR Prev = 0;
+	for (const TCHAR* Char = Name; *Char; ++Char, ++NameLen)
+	{
+		if (QueryPos < QueryLen && FChar::ToLower(*Char) == LowerQuery[QueryPos])
+		{
+			const bool bWordStart = NameLen == 0 || !FChar::IsAlnum(Prev) || (FChar::IsLower(Prev) && FChar::IsUpper(*Char));
+			Score += 1 + (bWordStart ? WordStartBonus : 0) + Streak * StreakBonus;
+			Streak++;
+			if (FirstMatch == INDEX_NONE)
+			{
+				FirstMatch = NameLen;
+			}
+			QueryPos++;
+		}
+		else
+		{
+			if (FirstMatch != INDEX_NONE && QueryPos < QueryLen)
+			{
+				Score -= GapPenalty;
+			}
+			Streak = 0;
+		}
+		Prev = *Char;
+	}
+
+	if (QueryPos < QueryLen)
+	{
+		return -1;
+	}
+
+	// Among equal matches, shorter names come first.
+	Score -= FMath::Min(FirstMatch == INDEX_NONE ? 0 : FirstMatch, MaxLeadingPenalty) * GapPenalty;
+	Score -= NameLen / 8;
+	return FMath::Max(Score, 0);
+}
+
+void FBTreeNameIndex::AddHit(TArray<FBTreeNameHit>& Hits, const FBTreeNameHit& Hit, int32 MaxResults)
+{
+	// The worst hit is on top of the heap, ties going to the highest node index.
+	auto IsWorse = [](const FBTreeNameHit& A, const FBTreeNameHit& B)
+	{
+		return A.Score < B.Score || (A.Score == B.Score && A.NodeIndex > B.NodeIndex);
+	};
+
+	if (Hits.Num() < MaxResults)
+	{
+		Hits.HeapPush(Hit, IsWorse);
+	}
+	else if (IsWorse(Hits.HeapTop(), Hit))
+	{
+		FBTreeNameHit Worst;
+		Hits.HeapPop(Worst, IsWorse, false);
+		Hits.HeapPush(Hit, IsWorse);
+	}
+}
+
+void FBTreeNameIndex::Query(const FString& QueryText, int32 MaxResults, TArray<FBTreeNameHit>& OutHits) const
+{
+	OutHits.Reset();
+	if (QueryText.IsEmpty() || MaxResults <= 0)
+	{
+		return;
+	}
+
+	// A node renamed or reused may be listed twice under a trigram or character, and the fuzzy pass finds the names
+	// containing the query again, so every node is only scored once.
+	const FString LowerQuery = QueryText.ToLower();
+	TBitArray<> ScoredNodes(false, CharMasks.Num());
+	if (LowerQuery.Len() >= 3)
+	{
+		// Every name containing the query is listed under each of its trigrams, the rarest one being the shortest list.
+		const TArray<int32>* Candidates = nullptr;
+		for (int32 i = 0; i + 3 <= LowerQuery.Len(); i++)
+		{
+			const TArray<int32>* Nodes = Trigrams.Find(MakeTrigram(&LowerQuery[i]));
+			if (!Nodes)
+			{
+				Candidates = nullptr;
+				break;
+			}
+			if (!Candidates || Nodes->Num() < Candidates->Num())
+			{
+				Candidates = Nodes;
+			}
+		}
+
+		if (Candidates)
+		{
+			for (int32 NodeIndex : *Candidates)
+			{
+				if (CharMasks[NodeIndex] != 0 && !ScoredNodes[NodeIndex] && Store.IsValidNode(NodeIndex))
+				{
+					// A renamed node no longer containing the query is left to the fuzzy pass.
+					const TCHAR* Name = Store.GetName(NodeIndex);
+					if (FCString::Stristr(Name, *LowerQuery))
+					{
+						ScoredNodes[NodeIndex] = true;
+						AddHit(OutHits, { NodeIndex, ScoreName(Name, LowerQuery) + ContainsBonus }, MaxResults);
+					}
+				}
+			}
+		}
+	}
+
+	// Too few names contain the query, score every name holding its characters. The lists of the characters are
+	// intersected by walking the shortest one and testing the masks, which hold one bit per list the node is in.
+	if (OutHits.Num() < MaxResults)
+	{
+		const uint64 QueryMask = MakeCharMask(*LowerQuery);
+		const TArray<int32>* Candidates = nullptr;
+		for (int32 Bit = 0; Bit < NumCharBits; Bit++)
+		{
+			if ((QueryMask & (1ull << Bit)) && (!Candidates || CharNodes[Bit].Num() < Candidates->Num()))
+			{
+				Candidates = &CharNodes[Bit];
+			}
+		}
+
+		for (int32 i = 0; Candidates && i < Candidates->Num(); i++)
+		{
+			const int32 NodeIndex = (*Candidates)[i];
+			if ((CharMasks[NodeIndex] & QueryMask) == QueryMask && !ScoredNodes[NodeIndex] && Store.IsValidNode(NodeIndex))
+			{
+				ScoredNodes[NodeIndex] = true;
+				ScoreNode(Store, NodeIndex, LowerQuery, MaxResults, OutHits);
+			}
+		}
+	}
+
+	SortHits(OutHits);
+}
+
+void FBTreeNameIndex::QueryStore(const FBTreeNodeStore& NodeStore, const FString& QueryText, int32 MaxResults, TArray<FBTreeNameHit>& OutHits)
+{
+	OutHits.Reset();
+	if (QueryText.IsEmpty() || MaxResults <= 0)
+	{
+		return;
+	}
+
+	const FString LowerQuery = QueryText.ToLower();
+	for (int32 NodeIndex = 0; NodeIndex < NodeStore.Num(); NodeIndex++)
+	{
+		if (NodeStore.IsValidNode(NodeIndex))
+		{
+			ScoreNode(NodeStore, NodeIndex, LowerQuery, MaxResults, OutHits);
+		}
+	}
+	SortHits(OutHits);
+}
+
+void FBTreeNameIndex::ScoreNode(const FBTreeNodeStore& NodeStore, int32 NodeIndex, const FString& LowerQuery, int32 MaxResults, TArray<FBTreeNameHit>& Hits)
+{
+	const TCHAR* Name = NodeStore.GetName(NodeIndex);
+	const int32 Score = ScoreName(Name, LowerQuery);
+	if (Score >= 0)
+	{
+		AddHit(Hits, { NodeIndex, FCString::Stristr(Name, *LowerQuery) ? Score + ContainsBonus : Score }, MaxResults);
+	}
+}
+
+void FBTreeNameIndex::SortHits(TArray<FBTreeNameHit>& Hits)
+{
+	Hits.Sort([](const FBTreeNameHit& A, const FBTreeNameHit& B)
+	{
+		return A.Score > B.Score || (A.Score == B.Score && A.NodeIndex < B.NodeIndex);
+	});
+}
+
+SIZE_T FBTreeNameIndex::GetAllocatedSize() const
+{
+	SIZE_T Size = Trigrams.GetAllocatedSize() + CharMasks.GetAllocatedSize() + NumNodeEntries.GetAllocatedSize();
+	for (const auto& Trigram : Trigrams)
+	{
+		Size += Trigram.Value.GetAllocatedSize();
+	}
+	for (const TArray<int32>& Nodes : CharNodes)
+	{
+		Size += Nodes.GetAllocatedSize();
+	}
+	return Size;
+}
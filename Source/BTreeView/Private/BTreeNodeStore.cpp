@@ -0,0 +1,498 @@
+/// MIT License, Copyright Burak Kara, burak@burak.io, https://en.wikipedia.org/wiki/MIT_License
+
+#include "BTreeNodeStore.h"
+#include "BTreeNameIndex.h"
+#include "Async/MappedFileHandle.h"
+
+FBTreeNodeStore::FBTreeNodeStore()
+	: MappedChars(nullptr)
+	, NumMappedChars(0)
+{
+	Reset();
+}
+
+FBTreeNodeStore::~FBTreeNodeStore()
+{
+	ReleaseSnapshot();
+}
+
+void FBTreeNodeStore::Reset(int32 ExpectedNum, int32 ExpectedChars, int32 ExpectedExtraStrings)
+{
+	ReleaseSnapshot();
+
+	Keys.Empty(ExpectedNum);
+	IndicesByKey.Empty(ExpectedNum);
+	bKeyIndexPending = false;
+	FreeIndices.Empty();
+	Parents.Empty(ExpectedNum);
+	FirstChildren.Empty(ExpectedNum);
+	LastChildren.Empty(ExpectedNum);
+	NextSiblings.Empty(ExpectedNum);
+	PrevSiblings.Empty(ExpectedNum);
+	NumChildren.Empty(ExpectedNum);
+	Depths.Empty(ExpectedNum);
+	LiveNodes.Empty(ExpectedNum);
+	NameOffsets.Empty(ExpectedNum);
+	Paddings.Empty(ExpectedNum);
+	Flags.Empty(ExpectedNum);
+	DirectoryPathOffsets.Empty();
+	ExtraStringStarts.Empty(ExpectedNum);
+	ExtraStringCounts.Empty(ExpectedNum);
+	ExtraStringOffsets.Empty(ExpectedExtraStrings);
+	Chars.Empty(ExpectedChars + 1);
+	Chars.Add(TEXT('\0'));
+	NumGarbageChars = 0;
+	NumGarbageExtraStrings = 0;
+
+	FirstRoot = INDEX_NONE;
+	LastRoot = INDEX_NONE;
+	NumRoots = 0;
+	NumLiveNodes = 0;
+
+	if (NameIndex)
+	{
+		NameIndex->Reset();
+	}
+	Intervals.Reset();
+	bIntervalsPending = false;
+}
+
+void FBTreeNodeStore::ReleaseSnapshot()
+{
+	MappedChars = nullptr;
+	NumMappedChars = 0;
+	SnapshotRegion.Reset();
+	SnapshotFile.Reset();
+	SnapshotData.Empty();
+}
+
+void FBTreeNodeStore::BuildKeyIndex() const
+{
+	bKeyIndexPending = false;
+	IndicesByKey.Reserve(NumLiveNodes);
+	for (int32 Index = 0; Index < Keys.Num(); Index++)
+	{
+		if (LiveNodes[Index])
+		{
+			IndicesByKey.Add(Keys[Index], Index);
+		}
+	}
+}
+
+int32 FBTreeNodeStore::AddString(const FString& String)
+{
+	if (String.IsEmpty())
+	{
+		return 0;
+	}
+
+	const int32 Offset = NumMappedChars + Chars.Num();
+	Chars.Append(*String, String.Len());
+	Chars.Add(TEXT('\0'));
+	return Offset;
+}
+
+void FBTreeNodeStore::ReleaseString(int32 Offset)
+{
+	if (Offset != 0 && Offset >= NumMappedChars)
+	{
+		NumGarbageChars += FCString::Strlen(GetString(Offset)) + 1;
+	}
+}
+
+void FBTreeNodeStore::ReleaseExtraStrings(int32 Index)
+{
+	const int32 Start = ExtraStringStarts[Index];
+	for (int32 StringIndex = 0; StringIndex < ExtraStringCounts[Index]; StringIndex++)
+	{
+		ReleaseString(ExtraStringOffsets[Start + StringIndex]);
+	}
+	NumGarbageExtraStrings += ExtraStringCounts[Index];
+	ExtraStringCounts[Index] = 0;
+}
+
+void FBTreeNodeStore::CompactStringsIfNeeded()
+{
+	// Small buffers are left alone, compacting them would cost more than the memory it gives back.
+	static const int32 MinGarbage = 16 * 1024;
+
+	const bool bCompactChars = NumGarbageChars >= MinGarbage && NumGarbageChars > Chars.Num() - NumGarbageChars;
+	const bool bCompactExtraStrings = NumGarbageExtraStrings >= MinGarbage && NumGarbageExtraStrings > ExtraStringOffsets.Num() - NumGarbageExtraStrings;
+	if (!bCompactChars && !bCompactExtraStrings)
+	{
+		return;
+	}
+
+	// Both are rewritten together, the offsets of the extra strings being remapped anyway.
+	TArray<TCHAR> NewChars;
+	NewChars.Reserve(Chars.Num() - NumGarbageChars);
+	if (NumMappedChars == 0)
+	{
+		NewChars.Add(TEXT('\0'));
+	}
+	auto MoveString = [this, &NewChars](int32 Offset)
+	{
+		if (Offset == 0 || Offset < NumMappedChars)
+		{
+			return Offset;
+		}
+		const TCHAR* String = GetString(Offset);
+		const int32 NewOffset = NumMappedChars + NewChars.Num();
+		NewChars.Append(String, FCString::Strlen(String) + 1);
+		return NewOffset;
+	};
+
+	TArray<int32> NewExtraStringOffsets;
+	NewExtraStringOffsets.Reserve(ExtraStringOffsets.Num() - NumGarbageExtraStrings);
+	for (TConstSetBitIterator<> It(LiveNodes); It; ++It)
+	{
+		const int32 Index = It.GetIndex();
+		NameOffsets[Index] = MoveString(NameOffsets[Index]);
+
+		const int32 Start = ExtraStringStarts[Index];
+		ExtraStringStarts[Index] = NewExtraStringOffsets.Num();
+		for (int32 StringIndex = 0; StringIndex < ExtraStringCounts[Index]; StringIndex++)
+		{
+			NewExtraStringOffsets.Add(MoveString(ExtraStringOffsets[Start + StringIndex]));
+		}
+	}
+	for (auto& DirectoryPath : DirectoryPathOffsets)
+	{
+		DirectoryPath.Value = MoveString(DirectoryPath.Value);
+	}
+
+	Chars = MoveTemp(NewChars);
+	ExtraStringOffsets = MoveTemp(NewExtraStringOffsets);
+	NumGarbageChars = 0;
+	NumGarbageExtraStrings = 0;
+}
+
+void FBTreeNodeStore::AddExtraStrings(int32 Index, const TArray<FString>& ExtraStrings)
+{
+	ExtraStringStarts[Index] = ExtraStringOffsets.Num();
+	ExtraStringCounts[Index] = ExtraStrings.Num();
+	for (const FString& ExtraString : ExtraStrings)
+	{
+		ExtraStringOffsets.Add(AddString(ExtraString));
+	}
+}
+
+int32 FBTreeNodeStore::AddNode(int64 Key, int32 ParentIndex, const FString& Name, const FMargin& Padding, const TArray<FString>& ExtraStrings, uint8 NodeFlags)
+{
+	if (FindNode(Key) != INDEX_NONE)
+	{
+		return INDEX_NONE;
+	}
+
+	int32 Index;
+	if (FreeIndices.Num() > 0)
+	{
+		Index = FreeIndices.Pop(false);
+		Keys[Index] = Key;
+		FirstChildren[Index] = INDEX_NONE;
+		LastChildren[Index] = INDEX_NONE;
+		NumChildren[Index] = 0;
+		LiveNodes[Index] = true;
+		NameOffsets[Index] = AddString(Name);
+		Paddings[Index] = Padding;
+		Flags[Index] = NodeFlags;
+	}
+	else
+	{
+		Index = Keys.Add(Key);
+		Parents.Add(INDEX_NONE);
+		FirstChildren.Add(INDEX_NONE);
+		LastChildren.Add(INDEX_NONE);
+		NextSiblings.Add(INDEX_NONE);
+		PrevSiblings.Add(INDEX_NONE);
+		NumChildren.Add(0);
+		Depths.Add(0);
+		LiveNodes.Add(true);
+		NameOffsets.Add(AddString(Name));
+		Paddings.Add(Padding);
+		Flags.Add(NodeFlags);
+		ExtraStringStarts.Add(0);
+		ExtraStringCounts.Add(0);
+	}
+	AddExtraStrings(Index, ExtraStrings);
+
+	IndicesByKey.Add(Key, Index);
+	Link(Index, ParentIndex);
+	NumLiveNodes++;
+	if (NameIndex)
+	{
+		NameIndex->AddNode(Index);
+	}
+	return Index;
+}
+
+void FBTreeNodeStore::Link(int32 Index, int32 ParentIndex, int32 BeforeIndex)
+{
+	bIntervalsPending = true;
+
+	int32& First = ParentIndex == INDEX_NONE ? FirstRoot : FirstChildren[ParentIndex];
+	int32& Last = ParentIndex == INDEX_NONE ? LastRoot : LastChildren[ParentIndex];
+
+	Parents[Index] = ParentIndex;
+	Depths[Index] = ParentIndex == INDEX_NONE ? 0 : Depths[ParentIndex] + 1;
+	const int32 Prev = BeforeIndex == INDEX_NONE ? Last : PrevSiblings[BeforeIndex];
+	PrevSiblings[Index] = Prev;
+	NextSiblings[Index] = BeforeIndex;
+	if (Prev != INDEX_NONE)
+	{
+		NextSiblings[Prev] = Index;
+	}
+	else
+	{
+		First = Index;
+	}
+	if (BeforeIndex != INDEX_NONE)
+	{
+		PrevSiblings[BeforeIndex] = Index;
+	}
+	else
+	{
+		Last = Index;
+	}
+
+	int32& Count = ParentIndex == INDEX_NONE ? NumRoots : NumChildren[ParentIndex];
+	Count++;
+}
+
+void FBTreeNodeStore::Unlink(int32 Index)
+{
+	bIntervalsPending = true;
+
+	const int32 ParentIndex = Parents[Index];
+	int32& First = ParentIndex == INDEX_NONE ? FirstRoot : FirstChildren[ParentIndex];
+	int32& Last = ParentIndex == INDEX_NONE ? LastRoot : LastChildren[ParentIndex];
+
+	const int32 Prev = PrevSiblings[Index];
+	const int32 Next = NextSiblings[Index];
+	if (Prev != INDEX_NONE)
+	{
+		NextSiblings[Prev] = Next;
+	}
+	else
+	{
+		First = Next;
+	}
+	if (Next != INDEX_NONE)
+	{
+		PrevSiblings[Next] = Prev;
+	}
+	else
+	{
+		Last = Prev;
+	}
+
+	int32& Count = ParentIndex == INDEX_NONE ? NumRoots : NumChildren[ParentIndex];
+	Count--;
+
+	Parents[Index] = INDEX_NONE;
+	PrevSiblings[Index] = INDEX_NONE;
+	NextSiblings[Index] = INDEX_NONE;
+}
+
+void FBTreeNodeStore::RemoveSubtree(int32 Index, TArray<int32>* OutRemovedNodes)
+{
+	if (!IsValidNode(Index))
+	{
+		return;
+	}
+
+	EnsureKeyIndex();
+	Unlink(Index);
+
+	TArray<int32> PendingNodes;
+	PendingNodes.Add(Index);
+	while (PendingNodes.Num() > 0)
+	{
+		const int32 Current = PendingNodes.Pop(false);
+		for (int32 Child = FirstChildren[Current]; Child != INDEX_NONE; Child = NextSiblings[Child])
+		{
+			PendingNodes.Add(Child);
+		}
+
+		LiveNodes[Current] = false;
+		IndicesByKey.Remove(Keys[Current]);
+		FreeIndices.Add(Current);
+		NumLiveNodes--;
+		if (NameIndex)
+		{
+			NameIndex->RemoveNode(Current);
+		}
+
+		ReleaseString(NameOffsets[Current]);
+		NameOffsets[Current] = 0;
+		ReleaseExtraStrings(Current);
+		int32 PathOffset;
+		if (DirectoryPathOffsets.RemoveAndCopyValue(Current, PathOffset))
+		{
+			ReleaseString(PathOffset);
+		}
+		if (OutRemovedNodes)
+		{
+			OutRemovedNodes->Add(Current);
+		}
+	}
+	CompactStringsIfNeeded();
+}
+
+void FBTreeNodeStore::MoveNode(int32 Index, int32 NewParentIndex, int32 BeforeIndex)
+{
+	if (!IsValidNode(Index) || Index == BeforeIndex)
+	{
+		return;
+	}
+	check(BeforeIndex == INDEX_NONE || Parents[BeforeIndex] == NewParentIndex);
+
+	Unlink(Index);
+	Link(Index, NewParentIndex, BeforeIndex);
+
+	// Link set the depth of the node, its descendants follow.
+	TArray<int32> PendingNodes;
+	PendingNodes.Add(Index);
+	while (PendingNodes.Num() > 0)
+	{
+		const int32 Current = PendingNodes.Pop(false);
+		for (int32 Child = FirstChildren[Current]; Child != INDEX_NONE; Child = NextSiblings[Child])
+		{
+			Depths[Child] = Depths[Current] + 1;
+			PendingNodes.Add(Child);
+		}
+	}
+}
+
+void FBTreeNodeStore::SetChildOrder(int32 ParentIndex, const TArray<int32>& Children)
+{
+	bIntervalsPending = true;
+
+	int32& First = ParentIndex == INDEX_NONE ? FirstRoot : FirstChildren[ParentIndex];
+	int32& Last = ParentIndex == INDEX_NONE ? LastRoot : LastChildren[ParentIndex];
+
+	int32 Prev = INDEX_NONE;
+	for (int32 Child : Children)
+	{
+		PrevSiblings[Child] = Prev;
+		if (Prev != INDEX_NONE)
+		{
+			NextSiblings[Prev] = Child;
+		}
+		else
+		{
+			First = Child;
+		}
+		Prev = Child;
+	}
+	if (Prev != INDEX_NONE)
+	{
+		NextSiblings[Prev] = INDEX_NONE;
+	}
+	else
+	{
+		First = INDEX_NONE;
+	}
+	Last = Prev;
+}
+
+void FBTreeNodeStore::SetName(int32 Index, const FString& Name)
+{
+	if (NameIndex)
+	{
+		NameIndex->RemoveNode(Index);
+	}
+	ReleaseString(NameOffsets[Index]);
+	NameOffsets[Index] = AddString(Name);
+	if (NameIndex)
+	{
+		NameIndex->AddNode(Index);
+	}
+	CompactStringsIfNeeded();
+}
+
+void FBTreeNodeStore::SetNameIndexEnabled(bool bEnabled)
+{
+	if (bEnabled && !NameIndex)
+	{
+		NameIndex = MakeUnique<FBTreeNameIndex>(*this);
+		NameIndex->Build();
+	}
+	else if (!bEnabled)
+	{
+		NameIndex.Reset();
+	}
+}
+
+void FBTreeNodeStore::SetPadding(int32 Index, const FMargin& Padding)
+{
+	Paddings[Index] = Padding;
+}
+
+void FBTreeNodeStore::SetExtraStrings(int32 Index, const TArray<FString>& ExtraStrings)
+{
+	ReleaseExtraStrings(Index);
+	AddExtraStrings(Index, ExtraStrings);
+	CompactStringsIfNeeded();
+}
+
+void FBTreeNodeStore::SetDirectoryPath(int32 Index, const FString& Path)
+{
+	if (const int32* PathOffset = DirectoryPathOffsets.Find(Index))
+	{
+		ReleaseString(*PathOffset);
+	}
+	DirectoryPathOffsets.Add(Index, AddString(Path));
+	CompactStringsIfNeeded();
+}
+
+FString FBTreeNodeStore::GetDirectoryPath(int32 Index) const
+{
+	TArray<int32, TInlineAllocator<32>> Chain;
+	const int32* PathOffset = nullptr;
+	for (int32 Current = Index; Current != INDEX_NONE && !PathOffset; Current = Parents[Current])
+	{
+		PathOffset = DirectoryPathOffsets.Find(Current);
+		if (!PathOffset)
+		{
+			Chain.Add(Current);
+		}
+	}
+
+	FString Path = PathOffset ? GetString(*PathOffset) : TEXT("");
+	for (int32 i = Chain.Num() - 1; i >= 0; i--)
+	{
+		Path /= GetName(Chain[i]);
+	}
+	return Path;
+}
+
+void FBTreeNodeStore::GetExtraStrings(int32 Index, TArray<FString>& OutStrings) const
+{
+	const int32 Count = ExtraStringCounts[Index];
+	OutStrings.Reset(Count);
+	for (int32 StringIndex = 0; StringIndex < Count; StringIndex++)
+	{
+		OutStrings.Add(GetExtraString(Index, StringIndex));
+	}
+}
+
+void FBTreeNodeStore::GetChildren(int32 Index, TArray<int32>& OutChildren) const
+{
+	OutChildren.Reserve(OutChildren.Num() + (Index == INDEX_NONE ? NumRoots : NumChildren[Index]));
+	for (int32 Child = Index == INDEX_NONE ? FirstRoot : FirstChildren[Index]; Child != INDEX_NONE; Child = NextSiblings[Child])
+	{
+		OutChildren.Add(Child);
+	}
+}
+
+SIZE_T FBTreeNodeStore::GetAllocatedSize() const
+{
+	return Keys.GetAllocatedSize() + IndicesByKey.GetAllocatedSize() + FreeIndices.GetAllocatedSize()
+		+ Parents.GetAllocatedSize() + FirstChildren.GetAllocatedSize() + LastChildren.GetAllocatedSize()
+		+ NextSiblings.GetAllocatedSize() + PrevSiblings.GetAllocatedSize() + NumChildren.GetAllocatedSize() + Depths.GetAllocatedSize()
+		+ LiveNodes.GetAllocatedSize() + NameOffsets.GetAllocatedSize() + Paddings.GetAllocatedSize() + Flags.GetAllocatedSize()
+		+ DirectoryPathOffsets.GetAllocatedSize() + ExtraStringStarts.GetAllocatedSize() + ExtraStringCounts.GetAllocatedSize() + ExtraStringOffsets.GetAllocatedSize()
+		+ Chars.GetAllocatedSize() + SnapshotData.GetAllocatedSize() + (NameIndex ? NameIndex->GetAllocatedSize() : 0)
+		+ Intervals.GetAllocatedSize();
+}
@@ -0,0 +1,401 @@
+/// MIT License, Copyright Burak Kara, burak@burak.io, https://en.wikipedia.org/wiki/MIT_License
+
+#include "BTreeNodeStore.h"
+#include "BTreeNameIndex.h"
+#include "BTreeView.h"
+#include "Async/MappedFileHandle.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformFilemanager.h"
+#include "Misc/FileHelper.h"
+
+/**
+* Snapshot layout: a FSnapshotHeader followed by the columns below, each starting at a multiple of ColumnAlignment.
+*	Keys				int64[NumNodes]
+*	Parents				int32[NumNodes]
+*	FirstChildren		int32[NumNodes]
+*	LastChildren		int32[NumNodes]
+*	NextSiblings		int32[NumNodes]
+*	PrevSiblings		int32[NumNodes]
+*	NumChildren			int32[NumNodes]
+*	Depths				int32[NumNodes]
+*	NameOffsets			int32[NumNodes]
+*	Paddings			FMargin[NumNodes]
+*	Flags				uint8[NumNodes], EBTreeNodeFlags without ChildrenLoading
+*	ExtraStringStarts	int32[NumNodes]
+*	ExtraStringCounts	int32[NumNodes]
+*	ExtraStringOffsets	int32[NumExtraStrings]
+*	DirectoryPathNodes	int32[NumDirectoryPaths]
+*	DirectoryPathOffsets	int32[NumDirectoryPaths]
+*	Chars				TCHAR[NumChars], null-terminated strings starting with the shared empty string
+* Nodes are stored in depth-first order and there are no removed nodes.
+*/
+namespace BTreeNodeStoreSnapshot
+{
+	static const uint32 Magic = 0x53525442; // "BTRS"
+	static const uint32 Version = 4;
+	static const int64 ColumnAlignment = 8;
+
+	struct FSnapshotHeader
+	{
+		uint32 Magic;
+		uint32 Version;
+		uint32 CharSize;
+		uint32 UserFlags;
+		int32 NumNodes;
+		int32 FirstRoot;
+		int32 LastRoot;
+		int32 NumRoots;
+		int32 NumExtraStrings;
+		int32 NumDirectoryPaths;
+		int32 NumChars;
+	};
+
+	struct FSnapshotReader
+	{
+		const uint8* Data;
+		int64 Size;
+		int64 Cursor;
+
+		/** @return The next Bytes bytes of the snapshot, or null if it is too short */
+		const uint8* Read(int64 Bytes)
+		{
+			Cursor = Align(Cursor, ColumnAlignment);
+			if (Bytes < 0 || Cursor + Bytes > Size)
+			{
+				return nullptr;
+			}
+			const uint8* Column = Data + Cursor;
+			Cursor += Bytes;
+			return Column;
+		}
+
+		template<typename ElementType>
+		bool Read(TArray<ElementType>& OutColumn, int32 Num)
+		{
+			const uint8* Column = Read((int64)Num * sizeof(ElementType));
+			if (!Column)
+			{
+				return false;
+			}
+			OutColumn.SetNumUninitialized(Num);
+			FMemory::Memcpy(OutColumn.GetData(), Column, (SIZE_T)Num * sizeof(ElementType));
+			return true;
+		}
+	};
+
+	struct FSnapshotWriter
+	{
+		FArchive& Archive;
+
+		template<typename ElementType>
+		void Write(const TArray<ElementType>& Column)
+		{
+			uint8 Zeros[ColumnAlignment] = { 0 };
+			Archive.Serialize(Zeros, Align(Archive.Tell(), ColumnAlignment) - Archive.Tell());
+			Archive.Serialize(const_cast<ElementType*>(Column.GetData()), (int64)Column.Num() * sizeof(ElementType));
+		}
+	};
+}
+
+bool FBTreeNodeStore::SaveSnapshot(const FString& Filename, uint32 UserFlags) const
+{
+	using namespace BTreeNodeStoreSnapshot;
+
+	// Depth-first order, children being pushed last to first so they are popped in order.
+	TArray<int32> Order;
+	Order.Reserve(NumLiveNodes);
+	TArray<int32> NewIndices;
+	NewIndices.Init(INDEX_NONE, Num());
+	TArray<int32> PendingNodes;
+	for (int32 Root = LastRoot; Root != INDEX_NONE; Root = PrevSiblings[Root])
+	{
+		PendingNodes.Add(Root);
+	}
+	while (PendingNodes.Num() > 0)
+	{
+		const int32 Current = PendingNodes.Pop(false);
+		NewIndices[Current] = Order.Add(Current);
+		for (int32 Child = LastChildren[Current]; Child != INDEX_NONE; Child = PrevSiblings[Child])
+		{
+			PendingNodes.Add(Child);
+		}
+	}
+
+	const int32 NumNodes = Order.Num();
+	auto Remap = [&NewIndices](int32 Index)
+	{
+		return Index == INDEX_NONE ? INDEX_NONE : NewIndices[Index];
+	};
+
+	// Only the strings still in use are written.
+	TArray<TCHAR> NewChars;
+	NewChars.Add(TEXT('\0'));
+	auto AddNewString = [&NewChars](const TCHAR* String)
+	{
+		if (!*String)
+		{
+			return 0;
+		}
+		const int32 Offset = NewChars.Num();
+		NewChars.Append(String, FCString::Strlen(String) + 1);
+		return Offset;
+	};
+
+	TArray<int64> NewKeys;
+	TArray<int32> NewParents, NewFirstChildren, NewLastChildren, NewNextSiblings, NewPrevSiblings, NewNumChildren, NewDepths;
+	TArray<int32> NewNameOffsets, NewExtraStringStarts, NewExtraStringCounts, NewExtraStringOffsets;
+	TArray<FMargin> NewPaddings;
+	TArray<uint8> NewFlags;
+	NewKeys.Reserve(NumNodes);
+	NewParents.Reserve(NumNodes);
+	NewFirstChildren.Reserve(NumNodes);
+	NewLastChildren.Reserve(NumNodes);
+	NewNextSiblings.Reserve(NumNodes);
+	NewPrevSiblings.Reserve(NumNodes);
+	NewNumChildren.Reserve(NumNodes);
+	NewDepths.Reserve(NumNodes);
+	NewNameOffsets.Reserve(NumNodes);
+	NewPaddings.Reserve(NumNodes);
+	NewFlags.Reserve(NumNodes);
+	NewExtraStringStarts.Reserve(NumNodes);
+	NewExtraStringCounts.Reserve(NumNodes);
+	for (int32 Index : Order)
+	{
+		NewKeys.Add(Keys[Index]);
+		NewParents.Add(Remap(Parents[Index]));
+		NewFirstChildren.Add(Remap(FirstChildren[Index]));
+		NewLastChildren.Add(Remap(LastChildren[Index]));
+		NewNextSiblings.Add(Remap(NextSiblings[Index]));
+		NewPrevSiblings.Add(Remap(PrevSiblings[Index]));
+		NewNumChildren.Add(NumChildren[Index]);
+		NewDepths.Add(Depths[Index]);
+		NewNameOffsets.Add(AddNewString(GetName(Index)));
+		NewPaddings.Add(Paddings[Index]);
+		NewFlags.Add((uint8)(Flags[Index] & ~EBTreeNodeFlags::ChildrenLoading));
+		NewExtraStringStarts.Add(NewExtraStringOffsets.Num());
+		NewExtraStringCounts.Add(ExtraStringCounts[Index]);
+		for (int32 StringIndex = 0; StringIndex < ExtraStringCounts[Index]; StringIndex++)
+		{
+			NewExtraStringOffsets.Add(AddNewString(GetExtraString(Index, StringIndex)));
+		}
+	}
+
+	TArray<int32> NewDirectoryPathNodes, NewDirectoryPathOffsets;
+	for (const auto& DirectoryPath : DirectoryPathOffsets)
+	{
+		NewDirectoryPathNodes.Add(NewIndices[DirectoryPath.Key]);
+		NewDirectoryPathOffsets.Add(AddNewString(GetString(DirectoryPath.Value)));
+	}
+
+	TUniquePtr<FArchive> Archive(IFileManager::Get().CreateFileWriter(*Filename));
+	if (!Archive)
+	{
+		UE_LOG(LogBTreeView, Warning, TEXT("Could not write tree snapshot %s"), *Filename);
+		return false;
+	}
+
+	FSnapshotHeader Header;
+	Header.Magic = Magic;
+	Header.Version = Version;
+	Header.CharSize = sizeof(TCHAR);
+	Header.UserFlags = UserFlags;
+	Header.NumNodes = NumNodes;
+	Header.FirstRoot = Remap(FirstRoot);
+	Header.LastRoot = Remap(LastRoot);
+	Header.NumRoots = NumRoots;
+	Header.NumExtraStrings = NewExtraStringOffsets.Num();
+	Header.NumDirectoryPaths = NewDirectoryPathNodes.Num();
+	Header.NumChars = NewChars.Num();
+	Archive->Serialize(&Header, sizeof(Header));
+
+	FSnapshotWriter Writer{ *Archive };
+	Writer.Write(NewKeys);
+	Writer.Write(NewParents);
+	Writer.Write(NewFirstChildren);
+	Writer.Write(NewLastChildren);
+	Writer.Write(NewNextSiblings);
+	Writer.Write(NewPrevSiblings);
+	Writer.Write(NewNumChildren);
+	Writer.Write(NewDepths);
+	Writer.Write(NewNameOffsets);
+	Writer.Write(NewPaddings);
+	Writer.Write(NewFlags);
+	Writer.Write(NewExtraStringStarts);
+	Writer.Write(NewExtraStringCounts);
+	Writer.Write(NewExtraStringOffsets);
+	Writer.Write(NewDirectoryPathNodes);
+	Writer.Write(NewDirectoryPathOffsets);
+	Writer.Write(NewChars);
+	return Archive->Close();
+}
+
+bool FBTreeNodeStore::ValidateSnapshot(int32 NumChars, const TArray<int32>& DirectoryPathNodes, const TArray<int32>& DirectoryPathOffsets) const
+{
+	// A file of the right size may still hold anything, every index and offset is checked before it is followed.
+	const int32 NumNodes = Parents.Num();
+	const int32 NumExtraStrings = ExtraStringOffsets.Num();
+	auto IsValidLink = [NumNodes](int32 Index)
+	{
+		return Index >= INDEX_NONE && Index < NumNodes;
+	};
+	auto IsValidOffset = [NumChars](int32 Offset)
+	{
+		return Offset >= 0 && Offset < NumChars;
+	};
+
+	for (int32 Index = 0; Index < NumNodes; Index++)
+	{
+		if (!IsValidLink(Parents[Index]) || !IsValidLink(FirstChildren[Index]) || !IsValidLink(LastChildren[Index])
+			|| !IsValidLink(NextSiblings[Index]) || !IsValidLink(PrevSiblings[Index]) || !IsValidOffset(NameOffsets[Index])
+			|| ExtraStringStarts[Index] < 0 || ExtraStringCounts[Index] < 0
+			|| (int64)ExtraStringStarts[Index] + ExtraStringCounts[Index] > NumExtraStrings)
+		{
+			return false;
+		}
+	}
+	for (int32 Offset : ExtraStringOffsets)
+	{
+		if (!IsValidOffset(Offset))
+		{
+			return false;
+		}
+	}
+	for (int32 i = 0; i < DirectoryPathNodes.Num(); i++)
+	{
+		if (DirectoryPathNodes[i] < 0 || DirectoryPathNodes[i] >= NumNodes || !IsValidOffset(DirectoryPathOffsets[i]))
+		{
+			return false;
+		}
+	}
+
+	// The links must make a forest, or the walks over it would not end. Nodes come in depth-first order, so parents
+	// come before their children and next siblings after their previous ones, which rules out any cycle.
+	if (!IsValidLink(FirstRoot) || !IsValidLink(LastRoot) || (FirstRoot == INDEX_NONE) != (NumNodes == 0) || (NumNodes > 0 && FirstRoot != 0))
+	{
+		return false;
+	}
+	TArray<int32> NumLinkedChildren;
+	NumLinkedChildren.SetNumZeroed(NumNodes);
+	int32 NumLinkedRoots = 0;
+	for (int32 Index = 0; Index < NumNodes; Index++)
+	{
+		const int32 Parent = Parents[Index];
+		const int32 Prev = PrevSiblings[Index];
+		const int32 Next = NextSiblings[Index];
+		const int32 FirstChild = FirstChildren[Index];
+		const int32 LastChild = LastChildren[Index];
+		if (Parent >= Index || Depths[Index] != (Parent == INDEX_NONE ? 0 : Depths[Parent] + 1)
+			|| (Prev == INDEX_NONE ? (Parent == INDEX_NONE ? FirstRoot : FirstChildren[Parent]) != Index : Prev >= Index || Parents[Prev] != Parent || NextSiblings[Prev] != Index)
+			|| (Next == INDEX_NONE ? (Parent == INDEX_NONE ? LastRoot : LastChildren[Parent]) != Index : Next <= Index || Parents[Next] != Parent || PrevSiblings[Next] != Index)
+			|| (FirstChild == INDEX_NONE) != (LastChild == INDEX_NONE)
+			|| (FirstChild != INDEX_NONE && (FirstChild != Index + 1 || LastChild <= Index || Parents[FirstChild] != Index || Parents[LastChild] != Index)))
+		{
+			return false;
+		}
+		if (Parent == INDEX_NONE)
+		{
+			NumLinkedRoots++;
+		}
+		else
+		{
+			NumLinkedChildren[Parent]++;
+		}
+	}
+	if (NumLinkedRoots != NumRoots || NumLinkedChildren != NumChildren)
+	{
+		return false;
+	}
+	return true;
+}
+
+bool FBTreeNodeStore::LoadSnapshot(const FString& Filename, uint32& OutUserFlags)
+{
+	using namespace BTreeNodeStoreSnapshot;
+
+	Reset();
+
+	FSnapshotReader Reader{ nullptr, 0, 0 };
+	SnapshotFile.Reset(FPlatformFileManager::Get().GetPlatformFile().OpenMapped(*Filename));
+	if (SnapshotFile)
+	{
+		SnapshotRegion.Reset(SnapshotFile->MapRegion());
+	}
+	if (SnapshotRegion)
+	{
+		Reader.Data = SnapshotRegion->GetMappedPtr();
+		Reader.Size = SnapshotRegion->GetMappedSize();
+	}
+	else if (FFileHelper::LoadFileToArray(SnapshotData, *Filename, FILEREAD_Silent))
+	{
+		Reader.Data = SnapshotData.GetData();
+		Reader.Size = SnapshotData.Num();
+	}
+	else
+	{
+		UE_LOG(LogBTreeView, Warning, TEXT("Could not read tree snapshot %s"), *Filename);
+		Reset();
+		return false;
+	}
+
+	FSnapshotHeader Header;
+	const uint8* HeaderData = Reader.Read(sizeof(Header));
+	if (HeaderData)
+	{
+		FMemory::Memcpy(&Header, HeaderData, sizeof(Header));
+	}
+
+	const bool bValidHeader = HeaderData && Header.Magic == Magic && Header.Version == Version && Header.CharSize == sizeof(TCHAR)
+		&& Header.NumNodes >= 0 && Header.NumExtraStrings >= 0 && Header.NumDirectoryPaths >= 0 && Header.NumChars > 0;
+	const int32 NumNodes = bValidHeader ? Header.NumNodes : 0;
+	const TCHAR* SnapshotChars = nullptr;
+	TArray<int32> SnapshotDirectoryPathNodes, SnapshotDirectoryPathOffsets;
+	const bool bValidColumns = bValidHeader
+		&& Reader.Read(Keys, NumNodes)
+		&& Reader.Read(Parents, NumNodes)
+		&& Reader.Read(FirstChildren, NumNodes)
+		&& Reader.Read(LastChildren, NumNodes)
+		&& Reader.Read(NextSiblings, NumNodes)
+		&& Reader.Read(PrevSiblings, NumNodes)
+		&& Reader.Read(NumChildren, NumNodes)
+		&& Reader.Read(Depths, NumNodes)
+		&& Reader.Read(NameOffsets, NumNodes)
+		&& Reader.Read(Paddings, NumNodes)
+		&& Reader.Read(Flags, NumNodes)
+		&& Reader.Read(ExtraStringStarts, NumNodes)
+		&& Reader.Read(ExtraStringCounts, NumNodes)
+		&& Reader.Read(ExtraStringOffsets, Header.NumExtraStrings)
+		&& Reader.Read(SnapshotDirectoryPathNodes, Header.NumDirectoryPaths)
+		&& Reader.Read(SnapshotDirectoryPathOffsets, Header.NumDirectoryPaths)
+		&& (SnapshotChars = (const TCHAR*)Reader.Read((int64)Header.NumChars * sizeof(TCHAR))) != nullptr
+		&& SnapshotChars[Header.NumChars - 1] == TEXT('\0');
+	FirstRoot = Header.FirstRoot;
+	LastRoot = Header.LastRoot;
+	NumRoots = Header.NumRoots;
+	if (!bValidColumns || !ValidateSnapshot(Header.NumChars, SnapshotDirectoryPathNodes, SnapshotDirectoryPathOffsets))
+	{
+		UE_LOG(LogBTreeView, Warning, TEXT("%s is not a valid tree snapshot"), *Filename);
+		Reset();
+		return false;
+	}
+
+	// The strings stay in the snapshot, Chars only receives the strings added from now on.
+	MappedChars = SnapshotChars;
+	NumMappedChars = Header.NumChars;
+	Chars.Empty();
+
+	for (int32 i = 0; i < SnapshotDirectoryPathNodes.Num(); i++)
+	{
+		DirectoryPathOffsets.Add(SnapshotDirectoryPathNodes[i], SnapshotDirectoryPathOffsets[i]);
+	}
+
+	LiveNodes.Init(true, NumNodes);
+	NumLiveNodes = NumNodes;
+	bKeyIndexPending = NumNodes > 0;
+	bIntervalsPending = NumNodes > 0;
+	OutUserFlags = Header.UserFlags;
+	if (NameIndex)
+	{
+		NameIndex->Build();
+	}
+	return true;
+}
@@ -0,0 +1,259 @@
+/// MIT License, Copyright Burak Kara, burak@burak.io, https://en.wikipedia.org/wiki/MIT_License
+
+#include "BTreeSort.h"
+#include "BTreeNodeStore.h"
+#include "Algo/BinarySearch.h"
+#include "Async/ParallelFor.h"
+
+/** Number of characters packed in FSortKey::Prefix */
+static const int32 SortPrefixChars = 4;
+
+FBTreeSort::FBTreeSort(bool bInNatural, int32 InExtraStringIndex, bool bInDescending)
+	: bNatural(bInNatural)
+	, ExtraStringIndex(InExtraStringIndex)
+	, bDescending(bInDescending)
+{
+}
+
+FBTreeSort::FBTreeSort(const FBTreeNodeLess& InLess, bool bInDescending)
+	: bNatural(false)
+	, ExtraStringIndex(INDEX_NONE)
+	, bDescending(bInDescending)
+	, NativeLess(InLess)
+{
+}
+
+int32 FBTreeSort::CompareStrings(const TCHAR* A, const TCHAR* B, bool bCompareNumbers)
+{
+	// Numbers of equal value with different leading zeros only decide when everything else is equal.
+	int32 LeadingZerosOrder = 0;
+	for (;;)
+	{
+		if (bCompareNumbers && FChar::IsDigit(*A) && FChar::IsDigit(*B))
+		{
+			const TCHAR* NumberA = A;
+			const TCHAR* NumberB = B;
+			while (*A == TEXT('0'))
+			{
+				A++;
+			}
+			while (*B == TEXT('0'))
+			{
+				B++;
+			}
+			const TCHAR* DigitsA = A;
+			const TCHAR* DigitsB = B;
+			while (FChar::IsDigit(*A))
+			{
+				A++;
+			}
+			while (FChar::IsDigit(*B))
+			{
+				B++;
+			}
+
+			// Without leading zeros, the longer number is the larger one.
+			const int32 NumDigitsA = A - DigitsA;
+			const int32 NumDigitsB = B - DigitsB;
+			if (NumDigitsA != NumDigitsB)
+			{
+				return NumDigitsA < NumDigitsB ? -1 : 1;
+			}
+			for (int32 i = 0; i < NumDigitsA; i++)
+			{
+				if (DigitsA[i] != DigitsB[i])
+				{
+					return DigitsA[i] < DigitsB[i] ? -1 : 1;
+				}
+			}
+			if (LeadingZerosOrder == 0 && DigitsA - NumberA != DigitsB - NumberB)
+			{
+				LeadingZerosOrder = DigitsA - NumberA < DigitsB - NumberB ? -1 : 1;
+			}
+			continue;
+		}
+
+		const TCHAR LowerA = FChar::ToLower(*A);
+		const TCHAR LowerB = FChar::ToLower(*B);
+		if (LowerA != LowerB)
+		{
+			return LowerA < LowerB ? -1 : 1;
+		}
+		if (!LowerA)
+		{
+			return LeadingZerosOrder;
+		}
+		A++;
+		B++;
+	}
+}
+
+FBTreeSort::FSortKey FBTreeSort::MakeSortKey(const FBTreeNodeStore& Store, int32 NodeIndex) const
+{
+	FSortKey Key;
+	Key.NodeIndex = NodeIndex;
+	if (ExtraStringIndex == INDEX_NONE)
+	{
+		Key.String = Store.GetName(NodeIndex);
+	}
+	else
+	{
+		Key.String = ExtraStringIndex < Store.GetNumExtraStrings(NodeIndex) ? Store.GetExtraString(NodeIndex, ExtraStringIndex) : TEXT("");
+	}
+
+	// The prefix must never order two strings differently than CompareStrings, it may only leave them equal.
+	// Characters from 0xFFFF up are clamped to it and end the prefix, as they may differ in ways it can no longer tell,
+	// and a natural prefix stops at the first digit: numbers compare by value, but any digit compares to another
+	// character like '0' does.
+	Key.Prefix = 0;
+	const TCHAR* Char = Key.String;
+	bool bPrefixEnded = false;
+	for (int32 i = 0; i < SortPrefixChars; i++)
+	{
+		uint32 Code = 0;
+		if (*Char && !bPrefixEnded)
+		{
+			if (bNatural && FChar::IsDigit(*Char))
+			{
+				Code = TEXT('0');
+				bPrefixEnded = true;
+			}
+			else
+			{
+				Code = FMath::Min<uint32>(FChar::ToLower(*Char), 0xFFFF);
+				bPrefixEnded = Code == 0xFFFF;
+				Char++;
+			}
+		}
+		Key.Prefix = (Key.Prefix << 16) | Code;
+	}
+	return Key;
+}
+
+bool FBTreeSort::KeyLess(const FSortKey& A, const FSortKey& B) const
+{
+	if (A.Prefix != B.Prefix)
+	{
+		return bDescending ? A.Prefix > B.Prefix : A.Prefix < B.Prefix;
+	}
+	const int32 Order = CompareStrings(A.String, B.String, bNatural);
+	return bDescending ? Order > 0 : Order < 0;
+}
+
+bool FBTreeSort::Less(const FBTreeNodeStore& Store, int32 A, int32 B) const
+{
+	if (NativeLess)
+	{
+		return bDescending ? NativeLess(Store, B, A) : NativeLess(Store, A, B);
+	}
+	return KeyLess(MakeSortKey(Store, A), MakeSortKey(Store, B));
+}
+
+void FBTreeSort::SortGroup(FBTreeNodeStore& Store, int32 ParentIndex, TArray<int32>& Children) const
+{
+	if (NativeLess)
+	{
+		Children.StableSort([this, &Store](int32 A, int32 B)
+		{
+			return Less(Store, A, B);
+		});
+	}
+	else
+	{
+		TArray<FSortKey> Keys;
+		Keys.Reserve(Children.Num());
+		for (int32 Child : Children)
+		{
+			Keys.Add(MakeSortKey(Store, Child));
+		}
+		Keys.StableSort([this](const FSortKey& A, const FSortKey& B)
+		{
+			return KeyLess(A, B);
+		});
+		for (int32 i = 0; i < Keys.Num(); i++)
+		{
+			Children[i] = Keys[i].NodeIndex;
+		}
+	}
+	Store.SetChildOrder(ParentIndex, Children);
+}
+
+void FBTreeSort::SortAll(FBTreeNodeStore& Store) const
+{
+	// Groups of a single node are sorted already. INDEX_NONE stands for the roots.
+	TArray<int32> Parents;
+	if (Store.GetNumRoots() > 1)
+	{
+		Parents.Add(INDEX_NONE);
+	}
+	for (int32 NodeIndex = 0; NodeIndex < Store.Num(); NodeIndex++)
+	{
+		if (Store.IsValidNode(NodeIndex) && Store.GetNumChildren(NodeIndex) > 1)
+		{
+			Parents.Add(NodeIndex);
+		}
+	}
+
+	// Each group only reads and relinks the sibling links of its own children, so the groups do not overlap.
+	ParallelFor(Parents.Num(), [this, &Store, &Parents](int32 GroupIndex)
+	{
+		TArray<int32> Children;
+		Store.GetChildren(Parents[GroupIndex], Children);
+		SortGroup(Store, Parents[GroupIndex], Children);
+	});
+}
+
+void FBTreeSort::SortChildren(FBTreeNodeStore& Store, int32 ParentIndex) const
+{
+	TArray<int32> Children;
+	Store.GetChildren(ParentIndex, Children);
+	if (Children.Num() > 1)
+	{
+		SortGroup(Store, ParentIndex, Children);
+	}
+}
+
+void FBTreeSort::InsertSorted(FBTreeNodeStore& Store, const TArray<int32>& Nodes) const
+{
+	// Group the nodes by parent, so that each group of siblings is read and relinked once.
+	TSet<int32> PlacedNodes;
+	TMap<int32, TArray<int32>> NodesByParent;
+	for (int32 NodeIndex : Nodes)
+	{
+		bool bAlreadyPlaced;
+		PlacedNodes.Add(NodeIndex, &bAlreadyPlaced);
+		if (!bAlreadyPlaced && Store.IsValidNode(NodeIndex))
+		{
+			NodesByParent.FindOrAdd(Store.GetParent(NodeIndex)).Add(NodeIndex);
+		}
+	}
+
+	TArray<int32> Children;
+	for (const auto& Group : NodesByParent)
+	{
+		Children.Reset();
+		Store.GetChildren(Group.Key, Children);
+
+		// Placing many nodes one by one moves the others around more than sorting them all.
+		if (Group.Value.Num() * 4 > Children.Num())
+		{
+			SortGroup(Store, Group.Key, Children);
+			continue;
+		}
+
+		Children.RemoveAll([&PlacedNodes](int32 Child)
+		{
+			return PlacedNodes.Contains(Child);
+		});
+		for (int32 NodeIndex : Group.Value)
+		{
+			// After the siblings it equals, as if it was added last.
+			const int32 Position = Algo::UpperBound(Children, NodeIndex, [this, &Store](int32 A, int32 B)
+			{
+				return Less(Store, A, B);
+			});
+			Children.Insert(NodeIndex, Position);
+		}
+		Store.SetChildOrder(Group.Key, Children);
+	}
+}
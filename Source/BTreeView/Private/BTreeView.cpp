@@ -4,6 +4,8 @@
 
 #define LOCTEXT_NAMESPACE "FBTreeViewModule"
 
+DEFINE_LOG_CATEGORY(LogBTreeView);
+
 void FBTreeViewModule::StartupModule()
 {
 }
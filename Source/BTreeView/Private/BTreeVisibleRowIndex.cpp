@@ -0,0 +1,159 @@
+/// MIT License, Copyright Burak Kara, burak@burak.io, https://en.wikipedia.org/wiki/MIT_License
+
+#include "BTreeVisibleRowIndex.h"
+#include "BTreeNodeStore.h"
+
+/** Count of the positions past the last node, which are never rows */
+static const int32 PaddingCount = MAX_int32 / 2;
+
+void FBTreeVisibleRowIndex::Reset()
+{
+	Entries.Reset();
+	NumLeaves = 0;
+}
+
+void FBTreeVisibleRowIndex::Build(const FBTreeNodeStore& Store, const TBitArray<>& ExpandedNodes, const TBitArray<>* VisibleNodes)
+{
+	const int32 NumPositions = Store.GetNumPreorderNodes();
+	NumLeaves = FMath::RoundUpToPowerOfTwo(FMath::Max(NumPositions, 1));
+	Entries.SetNumUninitialized(NumLeaves * 2);
+
+	// Parents come before their children in the order, so the collapsed ancestors of a node are those of its parent
+	// and maybe the parent itself.
+	TArray<int32> CollapsedAncestors;
+	CollapsedAncestors.SetNumUninitialized(NumPositions);
+	for (int32 Position = 0; Position < NumPositions; Position++)
+	{
+		const int32 Node = Store.GetPreorderNode(Position);
+		const bool bExpanded = ExpandedNodes.IsValidIndex(Node) && ExpandedNodes[Node];
+		const bool bShown = !VisibleNodes || (VisibleNodes->IsValidIndex(Node) && (*VisibleNodes)[Node]);
+
+		const int32 Parent = Store.GetParent(Node);
+		CollapsedAncestors[Position] = 0;
+		if (Parent != INDEX_NONE)
+		{
+			const bool bParentExpanded = ExpandedNodes.IsValidIndex(Parent) && ExpandedNodes[Parent];
+			CollapsedAncestors[Position] = CollapsedAncestors[Store.GetPreorderPosition(Parent)] + (bParentExpanded ? 0 : 1);
+		}
+
+		const bool bPlaceholder = bExpanded && (Store.GetFlags(Node) & EBTreeNodeFlags::LazyChildren) && !(Store.GetFlags(Node) & EBTreeNodeFlags::ChildrenLoaded);
+		FEntry& Leaf = Entries[NumLeaves + Position];
+		Leaf.Min = CollapsedAncestors[Position] + (bShown ? 0 : 1);
+		Leaf.NumRows = bPlaceholder ? 2 : 1;
+		Leaf.Pending = 0;
+	}
+	for (int32 Position = NumPositions; Position < NumLeaves; Position++)
+	{
+		Entries[NumLeaves + Position] = { PaddingCount, 0, 0 };
+	}
+
+	for (int32 Entry = NumLeaves - 1; Entry > 0; Entry--)
+	{
+		Entries[Entry].Pending = 0;
+		UpdateEntry(Entry);
+	}
+}
+
+void FBTreeVisibleRowIndex::SetExpansion(const FBTreeNodeStore& Store, int32 NodeIndex, bool bExpanded, bool bPlaceholder)
+{
+	const int32 Position = Store.GetPreorderPosition(NodeIndex);
+	const int32 SubtreeSize = Store.GetSubtreeSize(NodeIndex);
+	if (SubtreeSize > 1)
+	{
+		AddToRange(1, 0, NumLeaves, Position + 1, Position + SubtreeSize, bExpanded ? -1 : 1);
+	}
+
+	int32 Entry = NumLeaves + Position;
+	Entries[Entry].NumRows = bExpanded && bPlaceholder ? 2 : 1;
+	for (Entry /= 2; Entry > 0; Entry /= 2)
+	{
+		UpdateEntry(Entry);
+	}
+}
+
+int32 FBTreeVisibleRowIndex::GetRow(const FBTreeNodeStore& Store, int32 NodeIndex) const
+{
+	const int32 Position = Store.GetPreorderPosition(NodeIndex);
+
+	// Walks down to the position, counting the rows of the ranges left of it.
+	int32 Row = 0;
+	int32 Added = 0;
+	int32 Entry = 1;
+	for (int32 Low = 0, Size = NumLeaves; Size > 1; Size /= 2)
+	{
+		Added += Entries[Entry].Pending;
+		const int32 Left = Entry * 2;
+		if (Position < Low + Size / 2)
+		{
+			Entry = Left;
+		}
+		else
+		{
+			if (Entries[Left].Min + Added == 0)
+			{
+				Row += Entries[Left].NumRows;
+			}
+			Entry = Left + 1;
+			Low += Size / 2;
+		}
+	}
+	return Entries[Entry].Min + Added == 0 ? Row : INDEX_NONE;
+}
+
+int32 FBTreeVisibleRowIndex::GetRowNode(const FBTreeNodeStore& Store, int32 Row) const
+{
+	if (Row < 0 || Row >= GetNumRows())
+	{
+		return INDEX_NONE;
+	}
+
+	// Walks down to the position holding the row, skipping the rows of the ranges left of it.
+	int32 Added = 0;
+	int32 Entry = 1;
+	while (Entry < NumLeaves)
+	{
+		Added += Entries[Entry].Pending;
+		const int32 Left = Entry * 2;
+		const int32 LeftRows = Entries[Left].Min + Added == 0 ? Entries[Left].NumRows : 0;
+		if (Row < LeftRows)
+		{
+			Entry = Left;
+		}
+		else
+		{
+			Row -= LeftRows;
+			Entry = Left + 1;
+		}
+	}
+	return Store.GetPreorderNode(Entry - NumLeaves);
+}
+
+void FBTreeVisibleRowIndex::AddToRange(int32 Entry, int32 Low, int32 High, int32 First, int32 Last, int32 Value)
+{
+	if (First <= Low && High <= Last)
+	{
+		Entries[Entry].Min += Value;
+		Entries[Entry].Pending += Value;
+		return;
+	}
+
+	const int32 Middle = (Low + High) / 2;
+	if (First < Middle)
+	{
+		AddToRange(Entry * 2, Low, Middle, First, Last, Value);
+	}
+	if (Last > Middle)
+	{
+		AddToRange(Entry * 2 + 1, Middle, High, First, Last, Value);
+	}
+	UpdateEntry(Entry);
+}
+
+void FBTreeVisibleRowIndex::UpdateEntry(int32 Entry)
+{
+	const FEntry& Left = Entries[Entry * 2];
+	const FEntry& Right = Entries[Entry * 2 + 1];
+	const int32 Min = FMath::Min(Left.Min, Right.Min);
+	Entries[Entry].Min = Min + Entries[Entry].Pending;
+	Entries[Entry].NumRows = (Left.Min == Min ? Left.NumRows : 0) + (Right.Min == Min ? Right.NumRows : 0);
+}
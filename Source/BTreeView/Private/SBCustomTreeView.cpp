@@ -4,6 +4,7 @@
 #include "BCustomTreeView.h"
 #include "SlateOptMacros.h"
 #include "SBAdvancedTableRow.h"
+#include "BTreeDragDropOp.h"
 
 BEGIN_SLATE_FUNCTION_BUILD_OPTIMIZATION
 void SBCustomTreeView::Construct(const FArguments& Args)
@@ -12,39 +13,159 @@ void SBCustomTreeView::Construct(const FArguments& Args)
 	TStyle = Args._TStyle;
 	ExpandedArrowStyle = Args._ExpandedArrowStyle;
 	ExpanderVisibility = Args._ExpanderVisibility;
-
-	ChildSlot
-		[
-			SNew(SScrollBox).Orientation(Orient_Vertical).Style(&TStyle->ScrollBoxStyle)
-			.ScrollBarStyle(&TStyle->VerticalScrollBarStyle).ScrollBarThickness(TStyle->VerticalScrollBarThickness)
-		+ SScrollBox::Slot().VAlign(VAlign_Fill).HAlign(HAlign_Fill)
-		.Padding(TStyle->TreeViewPadding)
-		[
-			SAssignNew(TView, STView)
-			.SelectionMode(ESelectionMode::Single).ExternalScrollbar(ExternalScrollbar())
+	NodeStore = Args._NodeStore;
+	SavedScrollOffset = 0.0f;
+	bHasSavedViewState = false;
+	bHasFilterExpansion = false;
+	bRestoringViewState = false;
+	bVisibleRowsPending = true;
+	bMultiSelect = TWidget.IsValid() && TWidget->MultiSelect;
+
+	// The tree view owns its scrolling so that it is arranged with a bounded height and only generates
+	// rows for the items that fit in the viewport. Wrapping it in a scroll box defeats the virtualization.
+	ScrollBar = ExternalScrollbar();
+	TSharedPtr<SHeaderRow> HeaderRow = MakeHeaderRow();
+
+	SAssignNew(TView, SBTreeView, SBTreeView::FOnSelectionDelta::CreateSP(this, &SBCustomTreeView::OnSelectionDelta))
+		.SelectionMode(bMultiSelect ? ESelectionMode::Multi : ESelectionMode::Single).ExternalScrollbar(ScrollBar)
 		.ClearSelectionOnClick(false)
 		.TreeItemsSource(&TreeStructure)
+		.HeaderRow(HeaderRow)
 		.OnGenerateRow(this, &SBCustomTreeView::OnGenerateRow)
 		.OnGetChildren(this, &SBCustomTreeView::OnGetChildren)
-		.OnSelectionChanged(this, &SBCustomTreeView::OnSelectionChanged)
 		.OnExpansionChanged(this, &SBCustomTreeView::OnExpansionChanged)
+		.OnRowReleased(this, &SBCustomTreeView::OnRowReleased);
+
+	// Columns wider than the tree scroll it horizontally. A horizontal scroll box still gives the tree view a
+	// bounded height, so rows are only generated for the viewport, and their cells are only painted where visible.
+	TSharedRef<SWidget> TreeContent = TView.ToSharedRef();
+	if (HeaderRow.IsValid())
+	{
+		TreeContent = SNew(SScrollBox).Orientation(Orient_Horizontal)
+			+ SScrollBox::Slot()
+			[
+				TView.ToSharedRef()
+			];
+	}
+
+	ChildSlot
+		[
+			SNew(SHorizontalBox)
+			+ SHorizontalBox::Slot().FillWidth(1).VAlign(VAlign_Fill).HAlign(HAlign_Fill)
+		.Padding(TStyle->TreeViewPadding)
+		[
+			TreeContent
+		]
+		+ SHorizontalBox::Slot().AutoWidth().VAlign(VAlign_Fill).HAlign(HAlign_Right)
+		[
+			ScrollBar.ToSharedRef()
 		]
 		];
 }
 
+TSharedPtr<SHeaderRow> SBCustomTreeView::MakeHeaderRow()
+{
+	if (!TWidget.IsValid() || TWidget->Columns.Num() == 0)
+	{
+		return nullptr;
+	}
+
+	ColumnLayout = MakeShared<FBTreeColumnLayout>();
+	ColumnLayout->TreeColumnWidth = TWidget->TreeColumnWidth;
+
+	TSharedRef<SHeaderRow> HeaderRow = SNew(SHeaderRow)
+		+ SHeaderRow::Column(TEXT("Tree"))
+		.DefaultLabel(TWidget->TreeColumnLabel)
+		.ManualWidth(this, &SBCustomTreeView::GetTreeColumnWidth)
+		.OnWidthChanged(this, &SBCustomTreeView::OnTreeColumnResized);
+
+	for (int32 Column = 0; Column < TWidget->Columns.Num(); Column++)
+	{
+		const FBTreeColumn& TreeColumn = TWidget->Columns[Column];
+		ColumnLayout->ExtraStringIndices.Add(FMath::Max(TreeColumn.ExtraStringIndex, (int32)INDEX_NONE));
+		ColumnLayout->Widths.Add(TreeColumn.Width);
+
+		HeaderRow->AddColumn(SHeaderRow::Column(*FString::Printf(TEXT("Column%d"), Column))
+			.DefaultLabel(TreeColumn.Label)
+			.ManualWidth(TAttribute<float>::Create(TAttribute<float>::FGetter::CreateSP(this, &SBCustomTreeView::GetColumnWidth, Column)))
+			.OnWidthChanged(FOnWidthChanged::CreateSP(this, &SBCustomTreeView::OnColumnResized, Column)));
+	}
+	return HeaderRow;
+}
+
+FOptionalSize SBCustomTreeView::GetTreeColumnSize() const
+{
+	return ColumnLayout.IsValid() ? FOptionalSize(ColumnLayout->TreeColumnWidth) : FOptionalSize();
+}
+
+float SBCustomTreeView::GetTreeColumnWidth() const
+{
+	return ColumnLayout->TreeColumnWidth;
+}
+
+float SBCustomTreeView::GetColumnWidth(int32 Column) const
+{
+	return ColumnLayout->Widths[Column];
+}
+
+void SBCustomTreeView::OnTreeColumnResized(float Width)
+{
+	ColumnLayout->TreeColumnWidth = Width;
+	if (TWidget.IsValid())
+	{
+		TWidget->TreeColumnWidth = Width;
+	}
+}
+
+void SBCustomTreeView::OnColumnResized(float Width, int32 Column)
+{
+	// The rows read the widths from the shared layout, they follow on their next layout.
+	ColumnLayout->Widths[Column] = Width;
+	if (TWidget.IsValid() && TWidget->Columns.IsValidIndex(Column))
+	{
+		TWidget->Columns[Column].Width = Width;
+	}
+}
+
 void SBCustomTreeView::ExpandTreeItem(TreeNodePtr Item)
 {
 	if (Item.IsValid())
 	{
 		TView->SetItemExpansion(Item, true);
-		RefreshTree(TreeStructure);
 	}
 }
 
 void SBCustomTreeView::OnGetChildren(TreeNodePtr Item, TArray< TreeNodePtr >& OutChildren)
 {
-	const auto& SubCategories = Item->GetSubDirectories();
-	OutChildren.Append(SubCategories);
+	if (!Item->IsValidNode())
+	{
+		return;
+	}
+
+	const int32 NodeIndex = Item->GetNodeIndex();
+
+	// Nodes with lazy children show a loading row until their children are provided.
+	const uint8 NodeFlags = NodeStore->GetFlags(NodeIndex);
+	if (NodeFlags & EBTreeNodeFlags::LazyChildren)
+	{
+		if (!(NodeFlags & EBTreeNodeFlags::ChildrenLoaded))
+		{
+			OutChildren.Add(GetPlaceholderHandle(NodeIndex));
+			return;
+		}
+		PlaceholderHandles.Remove(NodeIndex);
+	}
+
+	// Collapsed items report all of their children too, TView descends into them to keep the expansion of their
+	// descendants, and handles are only created once per node.
+	OutChildren.Reserve(OutChildren.Num() + NodeStore->GetNumChildren(NodeIndex));
+	for (int32 Child = NodeStore->GetFirstChild(NodeIndex); Child != INDEX_NONE; Child = NodeStore->GetNextSibling(Child))
+	{
+		if (IsNodeShown(Child))
+		{
+			OutChildren.Add(GetNodeHandle(Child));
+		}
+	}
 }
 
 void SBCustomTreeView::CollapseTreeItem(TreeNodePtr Item)
@@ -52,7 +173,6 @@ void SBCustomTreeView::CollapseTreeItem(TreeNodePtr Item)
 	if (Item.IsValid())
 	{
 		TView->SetItemExpansion(Item, false);
-		RefreshTree(TreeStructure);
 	}
 }
 
@@ -60,229 +180,651 @@ void SBCustomTreeView::ToggleNodeExpansion(TreeNodePtr Item)
 {
 	if (Item.IsValid())
 	{
-		if (TView->IsItemExpanded(Item))
+		TView->SetItemExpansion(Item, !TView->IsItemExpanded(Item));
+	}
+}
+
+void SBCustomTreeView::SetNodesExpansion(const TArray<int32>& NodeIndices, bool bExpand)
+{
+	for (int32 NodeIndex : NodeIndices)
+	{
+		if (NodeStore->IsValidNode(NodeIndex))
 		{
-			TView->SetItemExpansion(Item, false);
+			TView->SetItemExpansion(GetNodeHandle(NodeIndex), bExpand);
 		}
-		else
+	}
+}
+
+void SBCustomTreeView::ExpandAll()
+{
+	TArray<int32> ParentNodes;
+	for (int32 NodeIndex = 0; NodeIndex < NodeStore->Num(); NodeIndex++)
+	{
+		if (NodeStore->IsValidNode(NodeIndex) && NodeStore->GetNumChildren(NodeIndex) > 0)
 		{
-			TView->SetItemExpansion(Item, true);
+			ParentNodes.Add(NodeIndex);
 		}
-		RefreshTree(TreeStructure);
 	}
+	SetNodesExpansion(ParentNodes, true);
 }
 
-TSharedPtr<SScrollBar> SBCustomTreeView::ExternalScrollbar()
+void SBCustomTreeView::CollapseAll()
 {
-	return SNew(SScrollBar).Style(&TStyle->VerticalScrollBarStyle).Thickness(TStyle->VerticalScrollBarThickness);
+	// Only the expanded nodes are visited, rather than every node TView was given.
+	TArray<int32> NodesToCollapse;
+	for (TConstSetBitIterator<> It(ExpandedNodes); It; ++It)
+	{
+		NodesToCollapse.Add(It.GetIndex());
+	}
+	SetNodesExpansion(NodesToCollapse, false);
 }
 
-TSharedRef<ITableRow> SBCustomTreeView::OnGenerateRow(TreeNodePtr Item, const TSharedRef<STableViewBase>& OwnerTable)
+void SBCustomTreeView::ExpandToDepth(int32 Depth)
 {
-	if (!Item.IsValid())
+	TArray<int32> NodesToExpand;
+	for (int32 NodeIndex = 0; NodeIndex < NodeStore->Num(); NodeIndex++)
 	{
-		return SNew(SBAdvancedTableRow<TreeNodePtr>, OwnerTable)
-			[
-				SNew(STextBlock)
-				.Text(FText::FromString("EMPTY"))
-			];
+		if (NodeStore->IsValidNode(NodeIndex) && NodeStore->GetNumChildren(NodeIndex) > 0 && NodeStore->GetDepth(NodeIndex) < Depth)
+		{
+			NodesToExpand.Add(NodeIndex);
+		}
 	}
-	
-	const auto& SubCategories = Item->GetSubDirectories();
-	TArray< TreeNodePtr > OutChildren;
-	OutChildren.Append(SubCategories);
 
-	TreeNodePtr Parent = Item->GetParentCategory();
-	int32 Iteration = 0;
-	while (Parent.IsValid())
+	TArray<int32> NodesToCollapse;
+	for (TConstSetBitIterator<> It(ExpandedNodes); It; ++It)
 	{
-		Iteration++;
-		Parent = Parent->GetParentCategory();
+		if (NodeStore->IsValidNode(It.GetIndex()) && NodeStore->GetDepth(It.GetIndex()) >= Depth)
+		{
+			NodesToCollapse.Add(It.GetIndex());
+		}
 	}
 
-	FMargin RowPadding = TStyle->TextPadding +  FMargin(Iteration) * (TWidget->RowDefaultPadding + Item->GetTreeNodePadding());
-
-	FRow Row = FRow();
-	Row.NodeId = Item->GetNodeID();
+	SetNodesExpansion(NodesToCollapse, false);
+	SetNodesExpansion(NodesToExpand, true);
+}
 
-	if (GEngine->GameViewport)
+void SBCustomTreeView::ExpandPath(int32 NodeIndex)
+{
+	TArray<int32> Ancestors;
+	for (int32 Parent = NodeStore->GetParent(NodeIndex); Parent != INDEX_NONE; Parent = NodeStore->GetParent(Parent))
 	{
-		UWorld* world = GEngine->GameViewport->GetWorld();
-		bool isrowcontentvalid = false;
-		TSubclassOf<class UUserWidget> CurrentRowContent;
-		if (TWidget->DefaultRowContent)
-		{
-			isrowcontentvalid = true;
-			CurrentRowContent = TWidget->DefaultRowContent;
-		}
+		Ancestors.Add(Parent);
+	}
+	SetNodesExpansion(Ancestors, true);
+}
 
-		for (int i = 0; i < TWidget->RowContentsByParent.Num(); i++)
-		{
-			if (TWidget->RowContentsByParent[i].RowContent && TWidget->RowContentsByParent[i].ParentID == Item->GetParentID())
-			{
-				isrowcontentvalid = true;
-				CurrentRowContent = TWidget->RowContentsByParent[i].RowContent;
-				break;
-			}
-		}
+void SBCustomTreeView::SetSubtreeExpansion(int32 NodeIndex, bool bExpand)
+{
+	// The node itself may only have lazy children, which are requested when it expands.
+	TArray<int32> SubtreeNodes;
+	SubtreeNodes.Add(NodeIndex);
 
-		for (int i = 0; i < TWidget->RowContentsById.Num(); i++)
+	TArray<int32> Stack;
+	for (int32 Child = NodeStore->GetFirstChild(NodeIndex); Child != INDEX_NONE; Child = NodeStore->GetNextSibling(Child))
+	{
+		Stack.Add(Child);
+	}
+	while (Stack.Num() > 0)
+	{
+		const int32 Node = Stack.Pop(false);
+		if (NodeStore->GetNumChildren(Node) > 0)
 		{
-			if (TWidget->RowContentsById[i].RowContent && TWidget->RowContentsById[i].NodeId == Item->GetNodeID())
+			SubtreeNodes.Add(Node);
+			for (int32 Child = NodeStore->GetFirstChild(Node); Child != INDEX_NONE; Child = NodeStore->GetNextSibling(Child))
 			{
-				isrowcontentvalid = true;
-				CurrentRowContent = TWidget->RowContentsById[i].RowContent;
-				break;
+				Stack.Add(Child);
 			}
 		}
+	}
 
-		if (world && isrowcontentvalid)
-		{
-			Row.RowWidget = CreateWidget<UUserWidget>(world, CurrentRowContent);
-			Rows.Add(Row);
-			TWidget->HandleOnGenerateRow(Item, Row.RowWidget, OutChildren);
+	SetNodesExpansion(SubtreeNodes, bExpand);
+}
 
-			if (TStyle->EnableTableRowStyle)
-			{
-				return SNew(SBAdvancedTableRow<TreeNodePtr>, OwnerTable).Style(&TStyle->TableRowStyle)
-					.ExpanderStyleSet(ExpandedArrowStyle).Padding(RowPadding)
-					.ExpanderVisibility(ExpanderVisibility)
-					[
-						Row.RowWidget->TakeWidget()
+int32 SBCustomTreeView::GetVisibleIndex(int32 NodeIndex)
+{
+	return NodeStore->IsValidNode(NodeIndex) ? GetVisibleRows().GetRow(*NodeStore, NodeIndex) : INDEX_NONE;
+}
 
-					];
-			}
-			else
-			{
+int32 SBCustomTreeView::GetNodeAtVisibleIndex(int32 VisibleIndex)
+{
+	return GetVisibleRows().GetRowNode(*NodeStore, VisibleIndex);
+}
 
-				return SNew(SBAdvancedTableRow<TreeNodePtr>, OwnerTable).Style(&TStyle->GetNoHoverTableRowStyle())
-					.ExpanderStyleSet(ExpandedArrowStyle).Padding(RowPadding)
-					.ExpanderVisibility(ExpanderVisibility)
-					[
-						Row.RowWidget->TakeWidget()
+int32 SBCustomTreeView::GetNumVisibleRows()
+{
+	return GetVisibleRows().GetNumRows();
+}
 
-					];
-			}
+void SBCustomTreeView::ScrollToNode(int32 NodeIndex)
+{
+	ExpandPath(NodeIndex);
+	const int32 VisibleIndex = GetVisibleIndex(NodeIndex);
+	if (VisibleIndex == INDEX_NONE)
+	{
+		return;
+	}
+
+	// The scroll offset counts rows, so the row is placed without TView looking for its item among the linearized ones.
+	// The last live row may only be partly shown.
+	const float ScrollOffset = TView->GetScrollOffset();
+	const int32 NumShownRows = FMath::Max(TView->GetNumLiveWidgets() - 1, 1);
+	if (VisibleIndex < ScrollOffset || VisibleIndex >= ScrollOffset + NumShownRows)
+	{
+		TView->SetScrollOffset(FMath::Max(VisibleIndex - NumShownRows / 2, 0));
+	}
+}
+
+FBTreeVisibleRowIndex& SBCustomTreeView::GetVisibleRows()
+{
+	if (bVisibleRowsPending)
+	{
+		VisibleRows.Build(*NodeStore, ExpandedNodes, Filter.IsValid() ? &Filter->VisibleNodes : nullptr);
+		bVisibleRowsPending = false;
+	}
+	return VisibleRows;
+}
+
+void SBCustomTreeView::OnExpanderShiftClicked(TreeNodePtr Item, bool bExpand)
+{
+	if (Item.IsValid() && Item->IsValidNode())
+	{
+		SetSubtreeExpansion(Item->GetNodeIndex(), bExpand);
+	}
+}
+
+void SBCustomTreeView::RefreshTreeItem(int32 NodeIndex)
+{
+	const FRow* Row = FindRow(NodeIndex);
+	if (!Row)
+	{
+		return;
+	}
+
+	if (Row->RowWidget)
+	{
+		TWidget->HandleOnRowRebind(GetNodeHandle(NodeIndex), Row->RowWidget);
+	}
+	else if (TSharedPtr<STextBlock> TextBlock = Row->TextBlock.Pin())
+	{
+		TextBlock->SetText(FText::FromString(NodeStore->GetName(NodeIndex)));
+	}
+	if (TSharedPtr<SBTreeRowCells> Cells = Row->Cells.Pin())
+	{
+		Cells->Refresh(*NodeStore, NodeIndex);
+	}
+}
+
+TreeNodePtr SBCustomTreeView::GetNodeHandle(int32 NodeIndex)
+{
+	TreeNodePtr& Handle = NodeHandles.FindOrAdd(NodeIndex);
+	if (!Handle.IsValid())
+	{
+		Handle = MakeShareable(new BCustomTreeNode(NodeIndex));
+	}
+	return Handle;
+}
+
+TreeNodePtr SBCustomTreeView::GetPlaceholderHandle(int32 NodeIndex)
+{
+	TreeNodePtr& Handle = PlaceholderHandles.FindOrAdd(NodeIndex);
+	if (!Handle.IsValid())
+	{
+		Handle = MakeShareable(new BCustomTreeNode(NodeIndex, true));
+	}
+	return Handle;
+}
+
+void SBCustomTreeView::OnNodesRemoved(const TArray<int32>& RemovedNodes)
+{
+	for (int32 NodeIndex : RemovedNodes)
+	{
+		TreeNodePtr Handle;
+		if (NodeHandles.RemoveAndCopyValue(NodeIndex, Handle))
+		{
+			Handle->Invalidate();
+		}
+		if (PlaceholderHandles.RemoveAndCopyValue(NodeIndex, Handle))
+		{
+			Handle->Invalidate();
 		}
-		else
+		if (ExpandedNodes.IsValidIndex(NodeIndex))
 		{
-			Rows.Add(Row);
-			TWidget->HandleOnGenerateRow(Item, Row.RowWidget, OutChildren);
+			ExpandedNodes[NodeIndex] = false;
+		}
 
-			if (TStyle->EnableTableRowStyle)
-			{
-				return SNew(SBAdvancedTableRow<TreeNodePtr>, OwnerTable).Style(&TStyle->TableRowStyle)
-					.ExpanderStyleSet(ExpandedArrowStyle).Padding(RowPadding)
-					.ExpanderVisibility(ExpanderVisibility)
+		// The row stays a child of TView until it is released, its content widget is returned to the pool then.
+		Rows.Remove(NodeIndex);
+	}
+	if (TView.IsValid())
+	{
+		TView->ForgetNodes(RemovedNodes);
+	}
+}
 
-					[
-						SNew(STextBlock).TextStyle(&TStyle->RowTextStyle)
-						.Text(FText::FromString(Item->GetDisplayName()))
+void SBCustomTreeView::SetFilter(const FBTreeFilterResultPtr& InFilter)
+{
+	Filter = InFilter;
+	HighlightText = Filter.IsValid() ? FText::FromString(Filter->Text) : FText::GetEmpty();
+	RefreshTree();
+}
 
-					];
-			}
-			else
-			{
-				return SNew(SBAdvancedTableRow<TreeNodePtr>, OwnerTable).Style(&TStyle->GetNoHoverTableRowStyle())
-					.ExpanderStyleSet(ExpandedArrowStyle).Padding(RowPadding)
-					.ExpanderVisibility(ExpanderVisibility)
+void SBCustomTreeView::SaveFilterExpansion()
+{
+	FilterExpandedKeys.Reset();
+	for (TConstSetBitIterator<> It(ExpandedNodes); It; ++It)
+	{
+		if (NodeStore->IsValidNode(It.GetIndex()))
+		{
+			FilterExpandedKeys.Add(NodeStore->GetKey(It.GetIndex()));
+		}
+	}
+	bHasFilterExpansion = true;
+}
 
-					[
-						SNew(STextBlock).TextStyle(&TStyle->RowTextStyle)
-						.Text(FText::FromString(Item->GetDisplayName()))
+void SBCustomTreeView::RestoreFilterExpansion()
+{
+	if (!bHasFilterExpansion)
+	{
+		return;
+	}
 
-					];
-			}
+	TArray<int32> NodesToCollapse;
+	for (TConstSetBitIterator<> It(ExpandedNodes); It; ++It)
+	{
+		if (NodeStore->IsValidNode(It.GetIndex()) && !FilterExpandedKeys.Contains(NodeStore->GetKey(It.GetIndex())))
+		{
+			NodesToCollapse.Add(It.GetIndex());
 		}
 	}
-	else
+	TArray<int32> NodesToExpand;
+	for (int64 Key : FilterExpandedKeys)
+	{
+		const int32 NodeIndex = NodeStore->FindNode(Key);
+		if (NodeIndex != INDEX_NONE && !(ExpandedNodes.IsValidIndex(NodeIndex) && ExpandedNodes[NodeIndex]))
+		{
+			NodesToExpand.Add(NodeIndex);
+		}
+	}
+	SetNodesExpansion(NodesToCollapse, false);
+	SetNodesExpansion(NodesToExpand, true);
+
+	FilterExpandedKeys.Empty();
+	bHasFilterExpansion = false;
+}
+
+FText SBCustomTreeView::GetHighlightText() const
+{
+	return HighlightText;
+}
+
+void SBCustomTreeView::SaveViewState()
+{
+	if (!TView.IsValid())
 	{
-		TWidget->HandleOnGenerateRow(Item, Row.RowWidget, OutChildren);
-		Rows.Add(Row);
+		return;
+	}
 
-		if (TStyle->EnableTableRowStyle)
+	for (TConstSetBitIterator<> It(ExpandedNodes); It; ++It)
+	{
+		if (NodeStore->IsValidNode(It.GetIndex()))
+		{
+			SavedExpandedKeys.Add(NodeStore->GetKey(It.GetIndex()));
+		}
+	}
+	for (TConstSetBitIterator<> It(TView->GetSelectedNodes()); It; ++It)
+	{
+		if (NodeStore->IsValidNode(It.GetIndex()))
 		{
-			return SNew(SBAdvancedTableRow< TreeNodePtr >, OwnerTable).Style(&TStyle->TableRowStyle)
-				.ExpanderStyleSet(ExpandedArrowStyle).Padding(RowPadding)
-				.ExpanderVisibility(ExpanderVisibility)
+			SavedSelectedKeys.Add(NodeStore->GetKey(It.GetIndex()));
+		}
+	}
+	if (!bHasSavedViewState)
+	{
+		SavedScrollOffset = TView->GetScrollOffset();
+		bHasSavedViewState = true;
+	}
+}
 
-				[
-					SNew(STextBlock).TextStyle(&TStyle->RowTextStyle)
-					.Text(FText::FromString(Item->GetDisplayName()))
+void SBCustomTreeView::RestoreViewState(bool bFinal)
+{
+	if (!bHasSavedViewState || !TView.IsValid())
+	{
+		return;
+	}
 
-				];
+	TGuardValue<bool> RestoringGuard(bRestoringViewState, true);
+	for (auto It = SavedExpandedKeys.CreateIterator(); It; ++It)
+	{
+		const int32 NodeIndex = NodeStore->FindNode(*It);
+		if (NodeIndex != INDEX_NONE)
+		{
+			TView->SetItemExpansion(GetNodeHandle(NodeIndex), true);
+			It.RemoveCurrent();
 		}
-		else
+	}
+	TArray<int32> SelectedNodes;
+	for (auto It = SavedSelectedKeys.CreateIterator(); It; ++It)
+	{
+		const int32 NodeIndex = NodeStore->FindNode(*It);
+		if (NodeIndex != INDEX_NONE)
 		{
-			return SNew(SBAdvancedTableRow< TreeNodePtr >, OwnerTable).Style(&TStyle->GetNoHoverTableRowStyle())
-				.ExpanderStyleSet(ExpandedArrowStyle).Padding(RowPadding)
-				.ExpanderVisibility(ExpanderVisibility)
+			SelectedNodes.Add(NodeIndex);
+			It.RemoveCurrent();
+		}
+	}
+	TView->SetNodesSelection(SelectedNodes, true);
+	TView->MarkSelectionReported();
+
+	if (bFinal)
+	{
+		TView->SetScrollOffset(SavedScrollOffset);
+		SavedExpandedKeys.Empty();
+		SavedSelectedKeys.Empty();
+		bHasSavedViewState = false;
+	}
+}
+
+TSharedPtr<SScrollBar> SBCustomTreeView::ExternalScrollbar()
+{
+	return SNew(SScrollBar).Style(&TStyle->VerticalScrollBarStyle).Thickness(TStyle->VerticalScrollBarThickness);
+}
+
+TSharedRef<ITableRow> SBCustomTreeView::OnGenerateRow(TreeNodePtr Item, const TSharedRef<STableViewBase>& OwnerTable)
+{
+	if (Item.IsValid() && Item->IsPlaceholder())
+	{
+		const int32 Depth = NodeStore->IsValidNode(Item->GetNodeIndex()) ? NodeStore->GetDepth(Item->GetNodeIndex()) + 1 : 0;
+		return SNew(SBAdvancedTableRow<TreeNodePtr>, OwnerTable).Style(&TStyle->GetNoHoverTableRowStyle())
+			.Padding(TStyle->TextPadding + FMargin(Depth) * TWidget->RowDefaultPadding)
+			[
+				SNew(STextBlock).TextStyle(&TStyle->RowTextStyle)
+				.Text(NSLOCTEXT("BTreeView", "LoadingChildren", "Loading..."))
+			];
+	}
+
+	if (!Item.IsValid() || !Item->IsValidNode())
+	{
+		return SNew(SBAdvancedTableRow<TreeNodePtr>, OwnerTable)
+			[
+				SNew(STextBlock)
+				.Text(FText::FromString("EMPTY"))
+			];
+	}
+
+	const int32 NodeIndex = Item->GetNodeIndex();
+	const int32 Depth = NodeStore->GetDepth(NodeIndex);
 
-				[
-					SNew(STextBlock).TextStyle(&TStyle->RowTextStyle)
-					.Text(FText::FromString(Item->GetDisplayName()))
+	FMargin RowPadding = TStyle->TextPadding +  FMargin(Depth) * (TWidget->RowDefaultPadding + NodeStore->GetPadding(NodeIndex));
 
-				];
+	FRow Row = FRow();
+	Row.NodeIndex = NodeIndex;
+	Row.RowWidget = nullptr;
+
+	bool bReusedRowWidget = false;
+	if (GEngine->GameViewport)
+	{
+		UWorld* world = GEngine->GameViewport->GetWorld();
+		TSubclassOf<class UUserWidget> CurrentRowContent = TWidget->GetRowContentClass(NodeIndex);
+		if (world && CurrentRowContent)
+		{
+			Row.RowWidget = TWidget->AcquireRowContent(world, CurrentRowContent, bReusedRowWidget);
 		}
 	}
+
+	if (bReusedRowWidget)
+	{
+		TWidget->HandleOnRowRebind(Item, Row.RowWidget);
+	}
+	else
+	{
+		TWidget->HandleOnGenerateRow(Item, Row.RowWidget);
+	}
+
+	const FTableRowStyle* RowStyle = TStyle->EnableTableRowStyle ? &TStyle->TableRowStyle : &TStyle->GetNoHoverTableRowStyle();
+
+	TSharedPtr<SWidget> RowContent;
+	if (Row.RowWidget)
+	{
+		RowContent = Row.RowWidget->TakeWidget();
+	}
+	else
+	{
+		TSharedRef<STextBlock> TextBlock = SNew(STextBlock).TextStyle(&TStyle->RowTextStyle)
+			.Text(FText::FromString(NodeStore->GetName(NodeIndex)))
+			.HighlightText(this, &SBCustomTreeView::GetHighlightText);
+		Row.TextBlock = TextBlock;
+		RowContent = TextBlock;
+	}
+
+	TSharedPtr<SBTreeRowCells> Cells;
+	if (ColumnLayout.IsValid())
+	{
+		Cells = SNew(SBTreeRowCells, *NodeStore, NodeIndex).Layout(ColumnLayout).TextStyle(&TStyle->RowTextStyle);
+		Row.Cells = Cells;
+	}
+
+	TSharedRef< SBAdvancedTableRow<TreeNodePtr> > TableRow = SNew(SBAdvancedTableRow<TreeNodePtr>, OwnerTable).Style(RowStyle)
+		.ExpanderStyleSet(ExpandedArrowStyle).Padding(RowPadding)
+		.ExpanderVisibility(ExpanderVisibility)
+		.OnExpanderShiftClicked(this, &SBCustomTreeView::OnExpanderShiftClicked)
+		.Cells(Cells)
+		.TreeColumnWidth(this, &SBCustomTreeView::GetTreeColumnSize)
+		.OnDragDetected(TWidget->AllowDragAndDrop ? FOnDragDetected::CreateSP(this, &SBCustomTreeView::OnRowDragDetected, Item) : FOnDragDetected())
+		.OnCanAcceptDrop(TWidget->AllowDragAndDrop ? SBAdvancedTableRow<TreeNodePtr>::FOnCanAcceptDrop::CreateSP(this, &SBCustomTreeView::OnRowCanAcceptDrop) : SBAdvancedTableRow<TreeNodePtr>::FOnCanAcceptDrop())
+		.OnAcceptDrop(TWidget->AllowDragAndDrop ? SBAdvancedTableRow<TreeNodePtr>::FOnAcceptDrop::CreateSP(this, &SBCustomTreeView::OnRowAcceptDrop) : SBAdvancedTableRow<TreeNodePtr>::FOnAcceptDrop())
+		[
+			RowContent.ToSharedRef()
+		];
+
+	Row.TableRow = TableRow;
+	// A node given a new row before its previous row was released, or a reused node index, replaces the previous
+	// entry. The previous row keeps its content widget until it is released.
+	Rows.Add(NodeIndex, Row);
+	TableRows.Add(&TableRow.Get(), Row);
+
+	return TableRow;
 }
 
-void SBCustomTreeView::OnSelectionChanged(TreeNodePtr Item, ESelectInfo::Type SelectInfo)
+FReply SBCustomTreeView::OnRowDragDetected(const FGeometry& MyGeometry, const FPointerEvent& MouseEvent, TreeNodePtr Item)
 {
-	if (Item.IsValid())
+	if (!Item.IsValid() || !Item->IsValidNode() || !MouseEvent.IsMouseButtonDown(EKeys::LeftMouseButton))
+	{
+		return FReply::Unhandled();
+	}
+
+	// Dragging a selected row drags the whole selection.
+	TArray<int32> DraggedNodes;
+	const int32 NodeIndex = Item->GetNodeIndex();
+	if (TView->IsNodeSelected(NodeIndex))
 	{
-		class UUserWidget* SelectedRowWidget;
-		for (int i = 0; i < Rows.Num(); i++)
+		DraggedNodes.Reserve(TView->GetNumSelectedNodes());
+		for (TConstSetBitIterator<> It(TView->GetSelectedNodes()); It; ++It)
 		{
-			if (Item->GetNodeID() == Rows[i].NodeId)
+			if (NodeStore->IsValidNode(It.GetIndex()))
 			{
-				SelectedRowWidget = Rows[i].RowWidget;
-				TWidget->HandleOnSelectionChanged(Item, SelectedRowWidget);
-				break;
+				DraggedNodes.Add(It.GetIndex());
 			}
 		}
 	}
 	else
 	{
-		TWidget->HandleOnSelectionLost();
+		DraggedNodes.Add(NodeIndex);
+	}
+	return FReply::Handled().BeginDragDrop(FBTreeDragDropOp::New(*NodeStore, DraggedNodes));
+}
+
+TOptional<EItemDropZone> SBCustomTreeView::OnRowCanAcceptDrop(const FDragDropEvent& DragDropEvent, EItemDropZone DropZone, TreeNodePtr Item)
+{
+	TSharedPtr<FBTreeDragDropOp> Operation = DragDropEvent.GetOperationAs<FBTreeDragDropOp>();
+	if (!Operation.IsValid() || !Operation->IsFromStore(*NodeStore) || !Item.IsValid() || !Item->IsValidNode() || Item->IsPlaceholder())
+	{
+		return TOptional<EItemDropZone>();
 	}
+
+	// Nodes dropped around a row go to its parent, which is dragged if the row is. Either way one bit is read.
+	if (Operation->IsDragged(Item->GetNodeIndex()))
+	{
+		return TOptional<EItemDropZone>();
+	}
+	return DropZone;
+}
+
+FReply SBCustomTreeView::OnRowAcceptDrop(const FDragDropEvent& DragDropEvent, EItemDropZone DropZone, TreeNodePtr Item)
+{
+	TSharedPtr<FBTreeDragDropOp> Operation = DragDropEvent.GetOperationAs<FBTreeDragDropOp>();
+	if (!Operation.IsValid() || !Operation->IsFromStore(*NodeStore) || !TWidget.IsValid())
+	{
+		return FReply::Unhandled();
+	}
+
+	const int32 NodeIndex = Item->GetNodeIndex();
+	int32 NewParentIndex = NodeIndex;
+	int32 BeforeIndex = INDEX_NONE;
+	if (DropZone != EItemDropZone::OntoItem)
+	{
+		NewParentIndex = NodeStore->GetParent(NodeIndex);
+		BeforeIndex = DropZone == EItemDropZone::AboveItem ? NodeIndex : NodeStore->GetNextSibling(NodeIndex);
+	}
+	return TWidget->MoveNodeIndices(Operation->GetNodes(), NewParentIndex, BeforeIndex) ? FReply::Handled() : FReply::Unhandled();
+}
+
+void SBCustomTreeView::OnRowReleased(const TSharedRef<ITableRow>& TableRow)
+{
+	FRow Row;
+	if (!TableRows.RemoveAndCopyValue(&TableRow.Get(), Row))
+	{
+		return;
+	}
+
+	// The node may already have been given a new row, or removed, in which case its entry is gone.
+	const FRow* NodeRow = Rows.Find(Row.NodeIndex);
+	if (NodeRow && NodeRow->TableRow.HasSameObject(&TableRow.Get()))
+	{
+		Rows.Remove(Row.NodeIndex);
+	}
+	if (TWidget.IsValid())
+	{
+		TWidget->ReleaseRowContent(Row.RowWidget);
+	}
+}
+
+const FRow* SBCustomTreeView::FindRow(int32 NodeIndex) const
+{
+	return Rows.Find(NodeIndex);
+}
+
+void SBCustomTreeView::AddReferencedObjects(FReferenceCollector& Collector)
+{
+	for (auto& Row : TableRows)
+	{
+		Collector.AddReferencedObject(Row.Value.RowWidget);
+	}
+}
+
+FString SBCustomTreeView::GetReferencerName() const
+{
+	return TEXT("SBCustomTreeView");
+}
+
+void SBCustomTreeView::OnSelectionDelta(const FBSelectionDelta& Delta)
+{
+	if (!TWidget.IsValid())
+	{
+		return;
+	}
+
+	// The per node events only make sense for a single selection, a large multiple selection would call them per node.
+	if (!bMultiSelect)
+	{
+		if (Delta.SelectedNodes.Num() > 0)
+		{
+			// Nodes selected off screen have no live row.
+			const FRow* SelectedRow = FindRow(Delta.SelectedNodes[0]);
+			TWidget->HandleOnSelectionChanged(GetNodeHandle(Delta.SelectedNodes[0]), SelectedRow ? SelectedRow->RowWidget : nullptr);
+		}
+		else if (TView->GetNumSelectedNodes() == 0)
+		{
+			TWidget->HandleOnSelectionLost();
+		}
+	}
+	TWidget->HandleOnSelectionDelta(Delta);
 }
 
 void SBCustomTreeView::OnExpansionChanged(TreeNodePtr Item, bool ExpansionState)
 {
-	if (Item.IsValid())
+	if (Item.IsValid() && Item->IsValidNode())
 	{
-		class UUserWidget* ExpandedRowWidget;
-		for (int i = 0; i < Rows.Num(); i++)
+		const int32 NodeIndex = Item->GetNodeIndex();
+		if (NodeIndex >= ExpandedNodes.Num())
 		{
-			if (Item->GetNodeID() == Rows[i].NodeId)
-			{
-				ExpandedRowWidget = Rows[i].RowWidget;
-				TWidget->HandleOnExpansionChanged(Item, ExpandedRowWidget, ExpansionState);
-				break;
-			}
+			ExpandedNodes.Add(false, NodeIndex + 1 - ExpandedNodes.Num());
+		}
+		if (ExpandedNodes[NodeIndex] != ExpansionState && !bVisibleRowsPending)
+		{
+			const uint8 NodeFlags = NodeStore->GetFlags(NodeIndex);
+			VisibleRows.SetExpansion(*NodeStore, NodeIndex, ExpansionState, (NodeFlags & EBTreeNodeFlags::LazyChildren) && !(NodeFlags & EBTreeNodeFlags::ChildrenLoaded));
+		}
+		ExpandedNodes[NodeIndex] = ExpansionState;
+
+		// Restored nodes still load their lazy children.
+		TWidget->HandleOnLazyNodeExpansionChanged(NodeIndex, ExpansionState);
+		if (bRestoringViewState)
+		{
+			return;
 		}
+		// Nodes expanded from code, off screen, have no live row.
+		const FRow* ExpandedRow = FindRow(NodeIndex);
+		TWidget->HandleOnExpansionChanged(Item, ExpandedRow ? ExpandedRow->RowWidget : nullptr, ExpansionState);
 	}
 }
 
-void SBCustomTreeView::RefreshTree(TArray< TreeNodePtr > structure)
+void SBCustomTreeView::RefreshTree()
 {
-	TreeStructure = structure;
+	TreeStructure.Reset(NodeStore->GetNumRoots());
+	for (int32 Root = NodeStore->GetFirstRoot(); Root != INDEX_NONE; Root = NodeStore->GetNextSibling(Root))
+	{
+		if (IsNodeShown(Root))
+		{
+			TreeStructure.Add(GetNodeHandle(Root));
+		}
+	}
+	bVisibleRowsPending = true;
+
 	if (TView.IsValid())
 	{
 		TView->RequestTreeRefresh();
 	}
 }
 
+void SBCustomTreeView::RebuildTree()
+{
+	for (auto& Handle : NodeHandles)
+	{
+		Handle.Value->Invalidate();
+	}
+	NodeHandles.Empty();
+	for (auto& Handle : PlaceholderHandles)
+	{
+		Handle.Value->Invalidate();
+	}
+	PlaceholderHandles.Empty();
+	ExpandedNodes.Empty();
+	if (TView.IsValid())
+	{
+		TView->ResetSelection();
+	}
+
+	RefreshTree();
+}
+
 TreeNodePtr SBCustomTreeView::GetSelectedDirectory() const
 {
 	if (TView.IsValid())
 	{
-		auto SelectedItems = TView->GetSelectedItems();
-		if (SelectedItems.Num() > 0)
+		const int32 NodeIndex = TView->GetFirstSelectedNode();
+		if (NodeIndex != INDEX_NONE)
 		{
-			const auto& SelectedCategoryItem = SelectedItems[0];
-			return SelectedCategoryItem;
+			return NodeHandles.FindRef(NodeIndex);
 		}
 	}
 	return NULL;
@@ -292,8 +834,68 @@ void SBCustomTreeView::SelectDirectory(const TreeNodePtr& CategoryToSelect)
 {
 	if (ensure(TView.IsValid()))
 	{
-		TView->SetSelection(CategoryToSelect);
+		TView->Private_ClearSelection();
+		TView->SetItemSelection(CategoryToSelect, true, ESelectInfo::Direct);
+	}
+}
+
+void SBCustomTreeView::SelectAll()
+{
+	if (TView.IsValid())
+	{
+		TView->SelectNodes(NodeStore->GetLiveNodes(), Filter.IsValid() ? &Filter->VisibleNodes : nullptr);
+	}
+}
+
+void SBCustomTreeView::SetSubtreeSelection(int32 NodeIndex, bool bSelect)
+{
+	if (!TView.IsValid() || !NodeStore->IsValidNode(NodeIndex))
+	{
+		return;
+	}
+
+	const TArrayView<const int32> Subtree = NodeStore->GetSubtree(NodeIndex);
+	TArray<int32> SubtreeNodes;
+	SubtreeNodes.Reserve(Subtree.Num());
+	for (int32 Node : Subtree)
+	{
+		if (IsNodeShown(Node))
+		{
+			SubtreeNodes.Add(Node);
+		}
 	}
+	TView->SetNodesSelection(SubtreeNodes, bSelect);
+}
+
+void SBCustomTreeView::SetNodesSelection(const TArray<int32>& NodeIndices, bool bSelect)
+{
+	if (TView.IsValid())
+	{
+		TView->SetNodesSelection(NodeIndices, bSelect);
+	}
+}
+
+void SBCustomTreeView::ClearSelection()
+{
+	if (TView.IsValid())
+	{
+		TView->ClearNodeSelection();
+	}
+}
+
+bool SBCustomTreeView::IsNodeSelected(int32 NodeIndex) const
+{
+	return TView.IsValid() && TView->IsNodeSelected(NodeIndex);
+}
+
+const TBitArray<>& SBCustomTreeView::GetSelectedNodes() const
+{
+	return TView->GetSelectedNodes();
+}
+
+int32 SBCustomTreeView::GetNumSelectedNodes() const
+{
+	return TView.IsValid() ? TView->GetNumSelectedNodes() : 0;
 }
 
 bool SBCustomTreeView::IsItemExpanded(const TreeNodePtr Item) const
@@ -305,6 +907,10 @@ void SBCustomTreeView::Tick(const FGeometry& AllottedGeometry, const double InCu
 {
 	SCompoundWidget::Tick(AllottedGeometry, InCurrentTime, InDeltaTime);
 
+	if (TWidget.IsValid())
+	{
+		TWidget->EvictLazyChildren(FPlatformTime::Seconds());
+	}
 }
 
 END_SLATE_FUNCTION_BUILD_OPTIMIZATION
\ No newline at end of file
@@ -0,0 +1,82 @@
+/// MIT License, Copyright Burak Kara, burak@burak.io, https://en.wikipedia.org/wiki/MIT_License
+
+#include "SBTreeRowCells.h"
+#include "BTreeNodeStore.h"
+#include "Fonts/FontMeasure.h"
+
+void SBTreeRowCells::Construct(const FArguments& InArgs, const FBTreeNodeStore& Store, int32 NodeIndex)
+{
+	check(InArgs._Layout.IsValid());
+	Layout = InArgs._Layout;
+	TextStyle = InArgs._TextStyle;
+	CellPadding = InArgs._CellPadding;
+
+	Refresh(Store, NodeIndex);
+}
+
+void SBTreeRowCells::Refresh(const FBTreeNodeStore& Store, int32 NodeIndex)
+{
+	const TArray<int32>& ExtraStringIndices = Layout->ExtraStringIndices;
+	CellTexts.SetNum(ExtraStringIndices.Num());
+	for (int32 Column = 0; Column < ExtraStringIndices.Num(); Column++)
+	{
+		const int32 StringIndex = ExtraStringIndices[Column];
+		if (StringIndex == INDEX_NONE)
+		{
+			CellTexts[Column] = Store.GetName(NodeIndex);
+		}
+		else if (StringIndex < Store.GetNumExtraStrings(NodeIndex))
+		{
+			CellTexts[Column] = Store.GetExtraString(NodeIndex, StringIndex);
+		}
+		else
+		{
+			CellTexts[Column].Reset();
+		}
+	}
+}
+
+int32 SBTreeRowCells::OnPaint(const FPaintArgs& Args, const FGeometry& AllottedGeometry, const FSlateRect& MyCullingRect,
+	FSlateWindowElementList& OutDrawElements, int32 LayerId, const FWidgetStyle& InWidgetStyle, bool bParentEnabled) const
+{
+	const FLinearColor TextColor = TextStyle->ColorAndOpacity.GetColor(InWidgetStyle) * InWidgetStyle.GetColorAndOpacityTint();
+	const ESlateDrawEffect DrawEffects = ShouldBeEnabled(bParentEnabled) ? ESlateDrawEffect::None : ESlateDrawEffect::DisabledEffect;
+	const float Height = AllottedGeometry.GetLocalSize().Y;
+
+	// Columns run left to right, the ones past the right edge of the clipping rect are not visited.
+	float CellStart = 0.0f;
+	for (int32 Column = 0; Column < CellTexts.Num(); Column++)
+	{
+		const float Width = Layout->Widths[Column];
+		const FSlateRect CellRect = AllottedGeometry.GetLayoutBoundingRect(FSlateRect(CellStart, 0.0f, CellStart + Width, Height));
+		if (CellRect.Left >= MyCullingRect.Right)
+		{
+			break;
+		}
+
+		if (!CellTexts[Column].IsEmpty() && FSlateRect::DoRectanglesIntersect(CellRect, MyCullingRect))
+		{
+			const FVector2D TextSize(FMath::Max(Width - CellPadding.GetTotalSpaceAlong<Orient_Horizontal>(), 0.0f), Height - CellPadding.GetTotalSpaceAlong<Orient_Vertical>());
+			OutDrawElements.PushClip(FSlateClippingZone(CellRect));
+			FSlateDrawElement::MakeText(OutDrawElements, LayerId,
+				AllottedGeometry.ToPaintGeometry(TextSize, FSlateLayoutTransform(FVector2D(CellStart + CellPadding.Left, CellPadding.Top))),
+				CellTexts[Column], TextStyle->Font, DrawEffects, TextColor);
+			OutDrawElements.PopClip();
+		}
+		CellStart += Width;
+	}
+	return LayerId;
+}
+
+FVector2D SBTreeRowCells::ComputeDesiredSize(float LayoutScaleMultiplier) const
+{
+	float Width = 0.0f;
+	for (int32 Column = 0; Column < CellTexts.Num(); Column++)
+	{
+		Width += Layout->Widths[Column];
+	}
+
+	const TSharedRef<FSlateFontMeasure> FontMeasure = FSlateApplication::Get().GetRenderer()->GetFontMeasureService();
+	return FVector2D(Width, FontMeasure->GetMaxCharacterHeight(TextStyle->Font, LayoutScaleMultiplier) / LayoutScaleMultiplier
+		+ CellPadding.GetTotalSpaceAlong<Orient_Vertical>());
+}
@@ -0,0 +1,281 @@
+/// MIT License, Copyright Burak Kara, burak@burak.io, https://en.wikipedia.org/wiki/MIT_License
+
+#include "SBTreeView.h"
+
+/** @return The bits of the given word of a bit array that hold elements, the last word being partly used */
+static uint32 GetWordMask(int32 NumBits, int32 Word)
+{
+	const int32 NumWordBits = NumBits - Word * NumBitsPerDWORD;
+	return NumWordBits >= NumBitsPerDWORD ? ~0u : (1u << NumWordBits) - 1;
+}
+
+void SBTreeView::Construct(const FArguments& InArgs, const FOnSelectionDelta& InOnSelectionDelta)
+{
+	OnSelectionDelta = InOnSelectionDelta;
+	NumSelectedNodes = 0;
+	bSelectionChanged = false;
+	LastSelectInfo = ESelectInfo::Direct;
+
+	STView::Construct(InArgs);
+}
+
+void SBTreeView::SetNodeBit(int32 NodeIndex, bool bSelected)
+{
+	if (NodeIndex >= SelectedNodes.Num())
+	{
+		if (!bSelected)
+		{
+			return;
+		}
+		SelectedNodes.Add(false, NodeIndex + 1 - SelectedNodes.Num());
+	}
+	if (SelectedNodes[NodeIndex] != bSelected)
+	{
+		SelectedNodes[NodeIndex] = bSelected;
+		NumSelectedNodes += bSelected ? 1 : -1;
+	}
+}
+
+void SBTreeView::SetNodesSelection(const TArray<int32>& NodeIndices, bool bSelected)
+{
+	if (SelectionMode.Get() == ESelectionMode::None || NodeIndices.Num() == 0)
+	{
+		return;
+	}
+
+	if (SelectionMode.Get() != ESelectionMode::Multi)
+	{
+		if (bSelected)
+		{
+			Private_ClearSelection();
+		}
+		SetNodeBit(NodeIndices.Last(), bSelected);
+	}
+	else
+	{
+		for (int32 NodeIndex : NodeIndices)
+		{
+			SetNodeBit(NodeIndex, bSelected);
+		}
+	}
+	Private_SignalSelectionChanged(ESelectInfo::Direct);
+}
+
+void SBTreeView::SelectNodes(const TBitArray<>& Nodes, const TBitArray<>* Mask)
+{
+	if (SelectionMode.Get() != ESelectionMode::Multi)
+	{
+		return;
+	}
+
+	const int32 NumBits = Mask ? FMath::Min(Nodes.Num(), Mask->Num()) : Nodes.Num();
+	if (SelectedNodes.Num() < NumBits)
+	{
+		SelectedNodes.Add(false, NumBits - SelectedNodes.Num());
+	}
+
+	uint32* Selected = SelectedNodes.GetData();
+	const uint32* Added = Nodes.GetData();
+	const uint32* Masked = Mask ? Mask->GetData() : nullptr;
+	const int32 NumWords = FMath::DivideAndRoundUp(NumBits, NumBitsPerDWORD);
+	for (int32 Word = 0; Word < NumWords; Word++)
+	{
+		const uint32 Bits = (Masked ? Added[Word] & Masked[Word] : Added[Word]) & GetWordMask(NumBits, Word);
+		NumSelectedNodes += FMath::CountBits(Bits & ~Selected[Word]);
+		Selected[Word] |= Bits;
+	}
+	Private_SignalSelectionChanged(ESelectInfo::Direct);
+}
+
+void SBTreeView::ClearNodeSelection()
+{
+	if (NumSelectedNodes > 0)
+	{
+		Private_ClearSelection();
+		Private_SignalSelectionChanged(ESelectInfo::Direct);
+	}
+}
+
+int32 SBTreeView::GetFirstSelectedNode() const
+{
+	if (NumSelectedNodes == 0)
+	{
+		return INDEX_NONE;
+	}
+	TConstSetBitIterator<> It(SelectedNodes);
+	return It ? It.GetIndex() : INDEX_NONE;
+}
+
+void SBTreeView::ForgetNodes(const TArray<int32>& NodeIndices)
+{
+	for (int32 NodeIndex : NodeIndices)
+	{
+		SetNodeBit(NodeIndex, false);
+		if (ReportedNodes.IsValidIndex(NodeIndex))
+		{
+			ReportedNodes[NodeIndex] = false;
+		}
+	}
+}
+
+void SBTreeView::ResetSelection()
+{
+	SelectedNodes.Empty();
+	ReportedNodes.Empty();
+	NumSelectedNodes = 0;
+	bSelectionChanged = false;
+}
+
+void SBTreeView::MarkSelectionReported()
+{
+	ReportedNodes = SelectedNodes;
+	bSelectionChanged = false;
+}
+
+bool SBTreeView::Private_IsItemSelected(const TreeNodePtr& TheItem) const
+{
+	return TheItem.IsValid() && TheItem->IsValidNode() && !TheItem->IsPlaceholder() && IsNodeSelected(TheItem->GetNodeIndex());
+}
+
+void SBTreeView::Private_SetItemSelection(TreeNodePtr TheItem, bool bShouldBeSelected, bool bWasUserDirected)
+{
+	// Loading rows share the node index of their parent and are never selected.
+	if (SelectionMode.Get() == ESelectionMode::None || !TheItem.IsValid() || !TheItem->IsValidNode() || TheItem->IsPlaceholder())
+	{
+		return;
+	}
+
+	// SListView::SetSelection only empties its own item set before selecting, the other bits are cleared here.
+	if (bShouldBeSelected && SelectionMode.Get() != ESelectionMode::Multi)
+	{
+		Private_ClearSelection();
+	}
+	SetNodeBit(TheItem->GetNodeIndex(), bShouldBeSelected);
+
+	if (bWasUserDirected)
+	{
+		SelectorItem = TheItem;
+		RangeSelectionStart = TheItem;
+	}
+	InertialScrollManager.ClearScrollVelocity();
+}
+
+void SBTreeView::Private_ClearSelection()
+{
+	// SetRange clears whole words at once.
+	if (NumSelectedNodes > 0)
+	{
+		SelectedNodes.SetRange(0, SelectedNodes.Num(), false);
+		NumSelectedNodes = 0;
+	}
+}
+
+void SBTreeView::Private_SelectRangeFromCurrentTo(TreeNodePtr InRangeSelectionEnd)
+{
+	if (SelectionMode.Get() == ESelectionMode::None)
+	{
+		return;
+	}
+
+	// The range runs over the rows shown between the two items, which are not contiguous node indices.
+	const TArray<TreeNodePtr>& ShownItems = *ItemsSource;
+	int32 RangeStart = RangeSelectionStart.IsValid() ? ShownItems.Find(RangeSelectionStart) : 0;
+	int32 RangeEnd = ShownItems.Find(InRangeSelectionEnd);
+	if (RangeEnd == INDEX_NONE)
+	{
+		return;
+	}
+	if (RangeStart == INDEX_NONE)
+	{
+		RangeStart = 0;
+	}
+	if (RangeEnd < RangeStart)
+	{
+		Swap(RangeStart, RangeEnd);
+	}
+
+	for (int32 ItemIndex = RangeStart; ItemIndex <= RangeEnd; ItemIndex++)
+	{
+		const TreeNodePtr& Item = ShownItems[ItemIndex];
+		if (Item.IsValid() && Item->IsValidNode() && !Item->IsPlaceholder())
+		{
+			SetNodeBit(Item->GetNodeIndex(), true);
+		}
+	}
+	InertialScrollManager.ClearScrollVelocity();
+}
+
+int32 SBTreeView::Private_GetNumSelectedItems() const
+{
+	return NumSelectedNodes;
+}
+
+void SBTreeView::Private_SignalSelectionChanged(ESelectInfo::Type SelectInfo)
+{
+	if (SelectionMode.Get() != ESelectionMode::None)
+	{
+		bSelectionChanged = true;
+		LastSelectInfo = SelectInfo;
+	}
+}
+
+void SBTreeView::NavigationSelect(const TreeNodePtr& InItemToSelect, const FInputEvent& InInputEvent)
+{
+	// Like Private_SetItemSelection, a plain key press goes through SetSelection and the other bits are cleared here.
+	if (SelectionMode.Get() == ESelectionMode::Multi && !InInputEvent.IsShiftDown() && !InInputEvent.IsControlDown())
+	{
+		Private_ClearSelection();
+	}
+	STView::NavigationSelect(InItemToSelect, InInputEvent);
+}
+
+void SBTreeView::Tick(const FGeometry& AllottedGeometry, const double InCurrentTime, const float InDeltaTime)
+{
+	STView::Tick(AllottedGeometry, InCurrentTime, InDeltaTime);
+
+	if (bSelectionChanged)
+	{
+		ReportSelection();
+	}
+}
+
+void SBTreeView::ReportSelection()
+{
+	bSelectionChanged = false;
+
+	const int32 NumBits = FMath::Max(SelectedNodes.Num(), ReportedNodes.Num());
+	SelectedNodes.Add(false, NumBits - SelectedNodes.Num());
+	ReportedNodes.Add(false, NumBits - ReportedNodes.Num());
+
+	// Whole words are compared, only the ones that differ are read bit by bit.
+	FBSelectionDelta Delta;
+	Delta.SelectInfo = LastSelectInfo;
+	const uint32* Selected = SelectedNodes.GetData();
+	const uint32* Reported = ReportedNodes.GetData();
+	const int32 NumWords = FMath::DivideAndRoundUp(NumBits, NumBitsPerDWORD);
+	for (int32 Word = 0; Word < NumWords; Word++)
+	{
+		uint32 Changed = (Selected[Word] ^ Reported[Word]) & GetWordMask(NumBits, Word);
+		while (Changed)
+		{
+			const uint32 Bit = FMath::CountTrailingZeros(Changed);
+			Changed &= Changed - 1;
+
+			const int32 NodeIndex = Word * NumBitsPerDWORD + Bit;
+			if (Selected[Word] & (1u << Bit))
+			{
+				Delta.SelectedNodes.Add(NodeIndex);
+			}
+			else
+			{
+				Delta.DeselectedNodes.Add(NodeIndex);
+			}
+		}
+	}
+	ReportedNodes = SelectedNodes;
+
+	if (Delta.SelectedNodes.Num() > 0 || Delta.DeselectedNodes.Num() > 0)
+	{
+		OnSelectionDelta.ExecuteIfBound(Delta);
+	}
+}
@@ -2,108 +2,58 @@
 
 #pragma once
 
-#include "Layout/Margin.h"
+#include "CoreMinimal.h"
 
 typedef TSharedPtr< class BCustomTreeNode > TreeNodePtr;
 
 /**
-* The Data for a single node in the Directory Tree
+* Handle to a single node in the Directory Tree, as given to the tree view widget.
+* The node data lives in FBTreeNodeStore; handles are only created for the nodes the tree view asks for.
 */
 class BCustomTreeNode
 {
 
 private:
 
-	/** Parent item or NULL if this is a root  */
-	TWeakPtr< BCustomTreeNode > ParentDir;
+	/** Index of the node in the node store, INDEX_NONE once the node is removed */
+	int32 NodeIndex;
 
-	/** Full path of this directory in the tree */
-	FString DirectoryPath;
-
-	/** Display name of the category */
-	FString DisplayName;
-
-	int32 ParentID;
-
-	int32 NodeID;
-
-	FMargin TreeNodePadding;
-
-	TArray<FString> ExtraStrings;
-	/** Child categories */
-	TArray< TreeNodePtr > SubDirectories;
+	/** Set for the loading row shown under a node whose children are requested, NodeIndex being that node */
+	bool bPlaceholder;
 
 public:
 
-	/** @return Returns the parent or NULL if this is a root */
-	const TreeNodePtr GetParentCategory()
-	{
-		return ParentDir.Pin();
-	}
-
-	/** @return the path on hard disk, read-only */
-	const FString& GetDirectoryPath()
-	{
-		return DirectoryPath;
-	}
-
-	/** @return name to display in file tree view! read-only */
-	const FString& GetDisplayName()
-	{
-		return DisplayName;
-	}
-
-	TArray<FString> GetExtraStrings()
-	{
-		return ExtraStrings;
-	}
-
-	const int32& GetParentID()
-	{
-		return ParentID;
-	}
-
-	const int32& GetNodeID()
-	{
-		return NodeID;
-	}
-
-	const FMargin& GetTreeNodePadding() 
+	/** @return the index of the node in the node store */
+	int32 GetNodeIndex() const
 	{
-		return TreeNodePadding;
+		return NodeIndex;
 	}
 
-	/** @return Returns all subdirectories, read-only */
-	const TArray< TreeNodePtr >& GetSubDirectories() 
+	/** @return false once the node has been removed from the node store, and for placeholders */
+	bool IsValidNode() const
 	{
-		return SubDirectories;
+		return NodeIndex != INDEX_NONE && !bPlaceholder;
 	}
 
-	/** @return Returns all subdirectories, read or write */
-	TArray< TreeNodePtr >& AccessSubDirectories()
+	bool IsPlaceholder() const
 	{
-		return SubDirectories;
+		return bPlaceholder;
 	}
 
-	/** Add a subdirectory to this node in the tree! */
-	void AddSubDirectory(TreeNodePtr NewSubDir)
+	/** Detaches the handle from its node, the node having been removed */
+	void Invalidate()
 	{
-		SubDirectories.Add(NewSubDir);
+		NodeIndex = INDEX_NONE;
 	}
 
 public:
 
 	/** Constructor for BCustomTreeNode */
-	BCustomTreeNode(TreeNodePtr IN_ParentDir, FString IN_DirectoryPath, FString IN_DisplayName , int32 IN_NodeID, int32 IN_ParentID , FMargin IN_TreeNodePadding , TArray<FString> IN_ExtraStrings)
+	BCustomTreeNode(int32 IN_NodeIndex, bool IN_bPlaceholder = false)
 	{
-		ParentDir = IN_ParentDir;
-		DirectoryPath = IN_DirectoryPath;
-		DisplayName = IN_DisplayName;
-		ParentID = IN_ParentID;
-		NodeID = IN_NodeID;
-		TreeNodePadding = IN_TreeNodePadding;
-		ExtraStrings = IN_ExtraStrings;
+		NodeIndex = IN_NodeIndex;
+		bPlaceholder = IN_bPlaceholder;
 	}
 
 
-};
\ No newline at end of file
+};
@@ -6,6 +6,9 @@
 #include "BTreeViewWidgetStyle.h"
 #include "UMGStyle.h"
 #include "Blueprint/UserWidget.h"
+#include "Async/Future.h"
+#include "BTreeSort.h"
+#include "BTreeAggregates.h"
 #include "BCustomTreeView.generated.h"
 
 USTRUCT(BlueprintType)
@@ -52,20 +55,67 @@ struct FBTreeNode
 {
 	GENERATED_BODY()
 
-	UPROPERTY(BlueprintReadOnly, Category = "BCustomTreeNode")
-	int32 NodeID;
+	/** Key of the node. Assigned from the position in TreeNodes unless UBCustomTreeView::UseStableNodeIDs is set. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "BCustomTreeNode")
+	int64 NodeID;
 
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "BCustomTreeNode")
 	FString NodeName;
 
+	/**
+	* 0 for root nodes. With stable node ids, the NodeID of the parent node; otherwise NodeID + 1 of the parent node,
+	* or -1 for nodes removed with RemoveSubtree.
+	*/
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "BCustomTreeNode")
-	int32 ParentID;
+	int64 ParentID;
 
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "BCustomTreeNode")
 	FMargin NodePadding;
 
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "BCustomTreeNode")
 	TArray<FString> ExtraStrings;		
+
+	/** Children of the node are requested from UBCustomTreeView::ChildProvider when the node is expanded */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "BCustomTreeNode")
+	bool HasLazyChildren = false;
+
+	/** Path of the node on disk, for trees created with CreateTreeFromDirectory */
+	UPROPERTY(BlueprintReadOnly, Category = "BCustomTreeNode")
+	FString DirectoryPath;
+};
+
+/**
+* Refers to a node of a UBCustomTreeView without copying it, its properties being read with the GetNode functions
+* of the tree view. Stays valid until the node is removed.
+*/
+USTRUCT(BlueprintType)
+struct FBTreeNodeHandle
+{
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadOnly, Category = "BCustomTreeNode")
+	int64 NodeID = 0;
+
+	/** Index of the node in the node store, looked up again from NodeID if the node was moved to another index */
+	int32 NodeIndex = INDEX_NONE;
+};
+
+/** Where the filter text was found in a node */
+USTRUCT(BlueprintType)
+struct FBTreeFilterMatch
+{
+	GENERATED_BODY()
+
+	/** Index in ExtraStrings of the matching string, -1 for the name */
+	UPROPERTY(BlueprintReadOnly, Category = "BTreeFilterMatch")
+	int32 ExtraStringIndex = INDEX_NONE;
+
+	/** Position of the filter text in the matching string */
+	UPROPERTY(BlueprintReadOnly, Category = "BTreeFilterMatch")
+	int32 Start = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "BTreeFilterMatch")
+	int32 Length = 0;
 };
 
 USTRUCT(BlueprintType)
@@ -74,7 +124,7 @@ struct FBRowContentTypeByParent
 	GENERATED_BODY()
 
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Style")
-	int32 ParentID;
+	int64 ParentID;
 
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Style")
 	TSubclassOf<class UUserWidget> RowContent;
@@ -86,12 +136,157 @@ struct FBRowContentTypeById
 	GENERATED_BODY()
 
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Style")
-	int32 NodeId;
+	int64 NodeId;
 
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Style")
 	TSubclassOf<class UUserWidget> RowContent;
 };
 
+USTRUCT(BlueprintType)
+struct FBRowContentTypeByDepth
+{
+	GENERATED_BODY()
+
+	/** Number of ancestors of the nodes, 0 for roots */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Style")
+	int32 Depth;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Style")
+	TSubclassOf<class UUserWidget> RowContent;
+};
+
+USTRUCT(BlueprintType)
+struct FBRowContentTypeByExtraString
+{
+	GENERATED_BODY()
+
+	/** Index in FBTreeNode::ExtraStrings of the string to match */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Style")
+	int32 ExtraStringIndex;
+
+	/** Value to match, ignoring case */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Style")
+	FString Value;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Style")
+	TSubclassOf<class UUserWidget> RowContent;
+};
+
+USTRUCT()
+struct FBRowContentPool
+{
+	GENERATED_BODY()
+
+	/** Row content widgets of a single class that are not shown by any row */
+	UPROPERTY(Transient)
+	TArray<class UUserWidget*> FreeWidgets;
+
+	/** Slate widgets of FreeWidgets, kept alive so reusing a widget does not rebuild its hierarchy */
+	TArray< TSharedPtr<SWidget> > FreeSlateWidgets;
+};
+
+/** Outcome of the last CreateTree call */
+USTRUCT(BlueprintType)
+struct FBTreeBuildReport
+{
+	GENERATED_BODY()
+
+	/** Number of nodes placed in the tree */
+	UPROPERTY(BlueprintReadOnly, Category = "BTreeBuildReport")
+	int32 NumNodes = 0;
+
+	/** Nodes whose parent is not in TreeNodes. They are left out of the tree along with their descendants. */
+	UPROPERTY(BlueprintReadOnly, Category = "BTreeBuildReport")
+	TArray<int64> OrphanNodeIDs;
+
+	/** Nodes whose parent chain loops back on itself, or that descend from such a loop */
+	UPROPERTY(BlueprintReadOnly, Category = "BTreeBuildReport")
+	TArray<int64> CycleNodeIDs;
+
+	/** Reserved or repeated NodeIDs, only the first node with a NodeID is used */
+	UPROPERTY(BlueprintReadOnly, Category = "BTreeBuildReport")
+	TArray<int64> DuplicateNodeIDs;
+
+	/** Number of nodes left out of the tree, including descendants of orphans */
+	UPROPERTY(BlueprintReadOnly, Category = "BTreeBuildReport")
+	int32 NumUnplacedNodes = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "BTreeBuildReport")
+	float BuildTimeMs = 0.0f;
+};
+
+/** A column of a UBCustomTreeView showing a string of each node as text */
+USTRUCT(BlueprintType)
+struct FBTreeColumn
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "BTreeColumn")
+	FText Label;
+
+	/** Extra string shown in the column, -1 for the name */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "BTreeColumn", meta = (ClampMin = "-1"))
+	int32 ExtraStringIndex = 0;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "BTreeColumn", meta = (ClampMin = "1"))
+	float Width = 100.0f;
+};
+
+/** Nodes that joined and left the selection of a UBCustomTreeView during a frame */
+USTRUCT(BlueprintType)
+struct FBTreeSelectionDelta
+{
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadOnly, Category = "BTreeSelectionDelta")
+	TArray<int64> SelectedNodeIDs;
+
+	UPROPERTY(BlueprintReadOnly, Category = "BTreeSelectionDelta")
+	TArray<int64> DeselectedNodeIDs;
+
+	/** Number of nodes selected after the change */
+	UPROPERTY(BlueprintReadOnly, Category = "BTreeSelectionDelta")
+	int32 NumSelected = 0;
+};
+
+/** How a FBTreeAggregate combines the nodes of a subtree */
+UENUM(BlueprintType)
+enum class EBTreeAggregateOperation : uint8
+{
+	/** Number of descendants */
+	Count,
+	/** Of the numeric values of the node and its descendants, the nodes without one being left out */
+	Sum,
+	Min,
+	Max,
+};
+
+/** Value that UBCustomTreeView keeps for the subtree of every node */
+USTRUCT(BlueprintType)
+struct FBTreeAggregate
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "BTreeAggregate")
+	EBTreeAggregateOperation Operation = EBTreeAggregateOperation::Count;
+
+	/** Extra string holding the numeric value of each node, unused by Count */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "BTreeAggregate", meta = (ClampMin = "0"))
+	int32 ExtraStringIndex = 0;
+};
+
+/** How UBCustomTreeView orders the children of each node */
+UENUM(BlueprintType)
+enum class EBTreeSortMode : uint8
+{
+	/** Children are not sorted, new ones are added last */
+	None,
+	/** By name or extra string, ignoring case */
+	CaseInsensitive,
+	/** Like CaseInsensitive, with numbers compared by value so that "Item 9" comes before "Item 10" */
+	Natural,
+};
+
 UCLASS(BlueprintType)
 class UBCustomTreeView : public UWidget
 {
@@ -99,32 +294,113 @@ class UBCustomTreeView : public UWidget
 
 public:
 	DECLARE_DYNAMIC_MULTICAST_DELEGATE_ThreeParams(FGenerateRowEvent, const FBTreeNode&, Row , class UUserWidget* ,  RowWidget, const TArray<FBTreeNode>&, Children);
+	DECLARE_DYNAMIC_MULTICAST_DELEGATE_ThreeParams(FRowRebindEvent, const FBTreeNode&, Row, class UUserWidget*, RowWidget, const TArray<FBTreeNode>&, Children);
 	DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FOnSelectionChangedEvent, const FBTreeNode&, Item, class UUserWidget*, RowWidget);
 	DECLARE_DYNAMIC_MULTICAST_DELEGATE(FOnSelectionLostEvent);
 	DECLARE_DYNAMIC_MULTICAST_DELEGATE_ThreeParams(FOnExpansionChangedEvent, const FBTreeNode&, Item, class UUserWidget*, RowWidget, const bool, ExpansionState);
+	DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FNodeRowEvent, const FBTreeNodeHandle&, Node, class UUserWidget*, RowWidget);
+	DECLARE_DYNAMIC_MULTICAST_DELEGATE_ThreeParams(FNodeExpansionChangedEvent, const FBTreeNodeHandle&, Node, class UUserWidget*, RowWidget, const bool, ExpansionState);
+	DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FOnTreeBuildProgressEvent, float, Progress, int32, NumNodes);
+	DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnTreeReadyEvent, const FBTreeBuildReport&, Report);
+	DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnFilterAppliedEvent, int32, NumMatches);
+	DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnSelectionSetChangedEvent, const FBTreeSelectionDelta&, Delta);
+	DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FOnNodesMovedEvent, const TArray<int64>&, NodeIDs, int64, NewParentID);
 
 	UBCustomTreeView();
 	virtual void ReleaseSlateResources(bool bReleaseChildren) override;
+	virtual void BeginDestroy() override;
 
 #if WITH_EDITOR
 	virtual const FText GetPaletteCategory() override;
+	virtual void PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent) override;
 #endif
 
+	/** Called when a row is generated for a node, read it with the GetNode functions */
 	UPROPERTY(BlueprintAssignable, Category = "Widget Event")
-	FGenerateRowEvent OnGenerateRow;
+	FNodeRowEvent OnGenerateNodeRow;
 
+	/** Called instead of OnGenerateNodeRow when a pooled row content widget is reused to show another node */
 	UPROPERTY(BlueprintAssignable, Category = "Widget Event")
-	FOnSelectionChangedEvent OnSelectionChanged;
+	FNodeRowEvent OnNodeRowRebind;
+
+	/** RowWidget is null when the node has no live row, such as a node selected off screen */
+	UPROPERTY(BlueprintAssignable, Category = "Widget Event")
+	FNodeRowEvent OnNodeSelectionChanged;
+
+	/** RowWidget is null when the node has no live row, such as a node expanded from code off screen */
+	UPROPERTY(BlueprintAssignable, Category = "Widget Event")
+	FNodeExpansionChangedEvent OnNodeExpansionChanged;
 
 	UPROPERTY(BlueprintAssignable, Category = "Widget Event")
 	FOnSelectionLostEvent OnSelectionLost;
-	
+
+	/**
+	* Called once per frame with the nodes selected and deselected during it, however many changed.
+	* With MultiSelect it replaces OnNodeSelectionChanged and OnSelectionLost, which are not called.
+	*/
+	UPROPERTY(BlueprintAssignable, Category = "Widget Event")
+	FOnSelectionSetChangedEvent OnSelectionSetChanged;
+
+	/** Called once when nodes are moved under a new parent, by MoveNode, MoveNodes or dropping dragged rows */
 	UPROPERTY(BlueprintAssignable, Category = "Widget Event")
+	FOnNodesMovedEvent OnNodesMoved;
+
+	/** Only called with UseLegacyNodeEvents, use OnGenerateNodeRow instead */
+	UPROPERTY(BlueprintAssignable, Category = "Widget Event|Legacy")
+	FGenerateRowEvent OnGenerateRow;
+
+	/** Only called with UseLegacyNodeEvents, use OnNodeRowRebind instead */
+	UPROPERTY(BlueprintAssignable, Category = "Widget Event|Legacy")
+	FRowRebindEvent OnRowRebind;
+
+	/** Only called with UseLegacyNodeEvents, use OnNodeSelectionChanged instead */
+	UPROPERTY(BlueprintAssignable, Category = "Widget Event|Legacy")
+	FOnSelectionChangedEvent OnSelectionChanged;
+
+	/** Only called with UseLegacyNodeEvents, use OnNodeExpansionChanged instead */
+	UPROPERTY(BlueprintAssignable, Category = "Widget Event|Legacy")
 	FOnExpansionChangedEvent OnExpansionChanged;
 
+	/**
+	* Called after every slice of CreateTreeAsync with the fraction of TreeNodes processed and the number of nodes in the tree.
+	* Directory trees report a fraction of 0 until they are complete, their size not being known up front.
+	*/
+	UPROPERTY(BlueprintAssignable, Category = "Widget Event")
+	FOnTreeBuildProgressEvent OnTreeBuildProgress;
+
+	/** Called when CreateTreeAsync has processed all of TreeNodes */
+	UPROPERTY(BlueprintAssignable, Category = "Widget Event")
+	FOnTreeReadyEvent OnTreeReady;
+
+	/** Called when the tree shows the result of SetFilterText, or of filtering again after the nodes changed */
+	UPROPERTY(BlueprintAssignable, Category = "Widget Event")
+	FOnFilterAppliedEvent OnFilterApplied;
+
 	UPROPERTY(EditAnyWhere , BlueprintReadWrite, Category = "TreeView")
 	TArray<FBTreeNode> TreeNodes;
 
+	/**
+	* Use the NodeID of each entry in TreeNodes as a key that survives rebuilds, with ParentID holding the NodeID of
+	* the parent. NodeID 0 is reserved for "no parent". When false, NodeIDs are positions in TreeNodes.
+	*/
+	UPROPERTY(EditAnyWhere, BlueprintReadWrite, Category = "TreeView")
+	bool UseStableNodeIDs;
+
+	/**
+	* Also call OnGenerateRow, OnRowRebind, OnSelectionChanged and OnExpansionChanged, which copy the node and,
+	* for rows, all of its children every time they are called.
+	*/
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "TreeView")
+	bool UseLegacyNodeEvents;
+
+	/** Supplies the children of nodes with HasLazyChildren, requires UseStableNodeIDs */
+	UPROPERTY(BlueprintReadWrite, Category = "TreeView|Lazy Children", meta = (MustImplement = "BTreeChildProvider"))
+	UObject* ChildProvider;
+
+	/** Seconds the provided children of a collapsed node are kept before being removed, 0 keeping them */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "TreeView|Lazy Children", meta = (ClampMin = "0"))
+	float LazyChildrenLifetime;
+
 	UPROPERTY(EditAnyWhere, BlueprintReadWrite, Category = "Style")
 	FBTreeViewStyle TreeViewStyle;
 	
@@ -137,43 +413,597 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Appearance")
 	bool ExpanderVisibility;
 
+	/**
+	* Row contents are chosen by RowContentsById, then RowContentsByParent, RowContentsByExtraString, RowContentsByDepth
+	* and DefaultRowContent, the first matching rule of an array winning. Call RefreshRowContentRules after changing them.
+	*/
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Content")
 	TArray<FBRowContentTypeByParent> RowContentsByParent;
 
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Content")
 	TArray<FBRowContentTypeById> RowContentsById;
 
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Content")
+	TArray<FBRowContentTypeByExtraString> RowContentsByExtraString;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Content")
+	TArray<FBRowContentTypeByDepth> RowContentsByDepth;
+
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Content")
 	TSubclassOf<class UUserWidget> DefaultRowContent;
 
+	/** Maximum number of unused row content widgets kept for reuse, per row content class. 0 disables pooling. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Content", meta = (ClampMin = "0"))
+	int32 RowContentPoolSize;
+
+	/**
+	* Keep a trigram index of the node names for FindNodesByName, updated as nodes change.
+	* Costs memory and time for every added node, without it every query reads all the names.
+	*/
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "TreeView|Search")
+	bool IndexNodeNames;
+
+	/**
+	* Columns shown after the first one, which holds the expanders and the row contents, under a header whose columns
+	* the user can resize, their widths being kept here. Each row draws its strings as text, without a widget per cell.
+	* Applies when the widget is built.
+	*/
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "TreeView|Columns")
+	TArray<FBTreeColumn> Columns;
+
+	/** Header of the first column when there are Columns */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "TreeView|Columns")
+	FText TreeColumnLabel;
+
+	/** Width of the first column when there are Columns, including the expanders and indentation */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "TreeView|Columns", meta = (ClampMin = "1"))
+	float TreeColumnWidth;
+
+	/**
+	* Let the user drag rows, along with the other selected rows, onto another row to reparent them or between rows
+	* to reorder them. Applies to the rows generated afterwards.
+	*/
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "TreeView|Drag and Drop")
+	bool AllowDragAndDrop;
+
+	/** Let the user select many nodes with Ctrl and Shift clicks. Applies when the widget is built. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "TreeView|Selection")
+	bool MultiSelect;
+
+	/** Order of the children of each node, and of the roots, kept as nodes are added, moved and updated */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "TreeView|Sort")
+	EBTreeSortMode SortMode;
+
+	/** Extra string the nodes are sorted by, -1 for the name */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "TreeView|Sort", meta = (ClampMin = "-1"))
+	int32 SortExtraStringIndex;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "TreeView|Sort")
+	bool SortDescending;
+
+	/**
+	* Values kept for the subtree of every node, read with GetNodeAggregate. Call RefreshAggregates after changing them.
+	*/
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "TreeView|Aggregates")
+	TArray<FBTreeAggregate> Aggregates;
+
+	/** Time CreateTreeAsync may spend building the tree per frame, in milliseconds */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "TreeView", meta = (ClampMin = "0.1"))
+	float AsyncBuildBudgetMs;
+
+	/**
+	* Builds the tree from TreeNodes. Parents may appear before or after their children, siblings keep their
+	* order in TreeNodes. Nodes that cannot be placed are listed in the build report.
+	* Nodes that were expanded or selected before are again, by NodeID, and the scroll offset is kept.
+	*/
 	UFUNCTION(BlueprintCallable, Category = "TreeView")
 	void CreateTree();
 
+	/**
+	* Builds the tree from TreeNodes over several frames, spending at most AsyncBuildBudgetMs per frame.
+	* The tree shows the nodes built so far. TreeNodes must not be changed until OnTreeReady,
+	* the Edit functions finish the build before they apply.
+	*/
+	UFUNCTION(BlueprintCallable, Category = "TreeView")
+	void CreateTreeAsync();
+
+	UFUNCTION(BlueprintPure, Category = "TreeView")
+	bool IsBuildingTree() const;
+
+	/** Builds the rest of the tree right away if CreateTreeAsync is in progress */
+	UFUNCTION(BlueprintCallable, Category = "TreeView")
+	void CompleteTreeBuild();
+
+	/**
+	* Adds the children requested from the ChildProvider, which may call this right away or later on.
+	* The children are only added to the tree, not to TreeNodes, and their ParentID is ignored.
+	* @return False if the node is not waiting for its children
+	*/
+	UFUNCTION(BlueprintCallable, Category = "TreeView|Lazy Children")
+	bool ProvideChildren(int64 NodeId, const TArray<FBTreeNode>& Children);
+
+	/**
+	* Only shows the nodes whose name, or one of its extra strings if bMatchExtraStrings, contains Text ignoring case,
+	* along with their ancestors, which are expanded. Matching runs on the thread pool and the result is applied on a
+	* later frame, OnFilterApplied firing then. A text containing the previous one only tests the previous matches.
+	* The nodes are filtered again whenever they change. An empty Text clears the filter, which gives back the expansion
+	* the tree had before it.
+	*/
+	UFUNCTION(BlueprintCallable, Category = "TreeView|Filter")
+	void SetFilterText(const FString& Text, bool bMatchExtraStrings = false);
+
+	UFUNCTION(BlueprintCallable, Category = "TreeView|Filter")
+	void ClearFilter();
+
+	UFUNCTION(BlueprintPure, Category = "TreeView|Filter")
+	bool IsFiltering() const;
+
+	/**
+	* Tells row widgets where to highlight the filter text, text rows highlighting it on their own
+	* @return False if the node does not match the filter shown by the tree
+	*/
+	UFUNCTION(BlueprintPure, Category = "TreeView|Filter")
+	bool GetNodeFilterMatch(const FBTreeNodeHandle& Node, FBTreeFilterMatch& Match) const;
+
+	/** Compiles the RowContents arrays into the lookup tables used when rows are generated */
+	UFUNCTION(BlueprintCallable, Category = "TreeView")
+	void RefreshRowContentRules();
+
+	/** Computes the Aggregates again, on the next GetNodeAggregate call */
+	UFUNCTION(BlueprintCallable, Category = "TreeView|Aggregates")
+	void RefreshAggregates();
+
+	/** @return What the last CreateTree call placed and left out */
+	UFUNCTION(BlueprintPure, Category = "TreeView")
+	const FBTreeBuildReport& GetBuildReport() const;
+
+	/**
+	* Replaces the tree with the directories, and optionally files, under RootPath. They are enumerated on the thread
+	* pool and added a batch at a time within AsyncBuildBudgetMs per frame, OnTreeReady firing once all are added.
+	* TreeNodes is emptied, NodeIDs are hashes of the paths and UseStableNodeIDs is set.
+	* @param bWatchChanges	Keep the tree in sync with changes on disk, only supported in the editor
+	*/
+	UFUNCTION(BlueprintCallable, Category = "TreeView|Directory")
+	void CreateTreeFromDirectory(const FString& RootPath, bool bIncludeFiles = true, bool bWatchChanges = true);
+
+	/** Saves the tree to a binary snapshot file that LoadTreeSnapshot can map back */
+	UFUNCTION(BlueprintCallable, Category = "TreeView|Snapshot")
+	bool SaveTreeSnapshot(const FString& Filename) const;
+
+	/**
+	* Replaces the tree with the one of a snapshot file, memory mapping it instead of reading TreeNodes.
+	* TreeNodes is emptied and UseStableNodeIDs is restored to its value when the snapshot was saved.
+	* With position based NodeIDs, nodes can only be added again after the next CreateTree.
+	* @return False if the file could not be loaded, the tree being left empty
+	*/
+	UFUNCTION(BlueprintCallable, Category = "TreeView|Snapshot")
+	bool LoadTreeSnapshot(const FString& Filename);
+
 	UFUNCTION(BlueprintCallable, Category = "TreeView")
-	void ExpandTreeItem(int32 NodeId);
+	void ExpandTreeItem(int64 NodeId);
 
 	UFUNCTION(BlueprintCallable, Category = "TreeView")
-	void CollapseTreeItem(int32 NodeId);
+	void CollapseTreeItem(int64 NodeId);
 
 	UFUNCTION(BlueprintCallable, Category = "TreeView")
-	void ToggleNodeExpansion(int32 NodeId);
+	void ToggleNodeExpansion(int64 NodeId);
 
 	UFUNCTION(BlueprintCallable, Category = "TreeView")
-	void SelectTreeItem(int32 NodeId);
+	void SelectTreeItem(int64 NodeId);
+
+	/**
+	* Expands every node that has children. Lazy children that were not loaded yet are not requested.
+	* Like the other batch functions, the tree is refreshed once on the next frame however many nodes change.
+	*/
+	UFUNCTION(BlueprintCallable, Category = "TreeView|Expansion")
+	void ExpandAll();
+
+	UFUNCTION(BlueprintCallable, Category = "TreeView|Expansion")
+	void CollapseAll();
+
+	/** Expands the nodes with fewer than Depth ancestors and collapses the others, 0 collapsing every root */
+	UFUNCTION(BlueprintCallable, Category = "TreeView|Expansion")
+	void ExpandToDepth(int32 Depth);
+
+	/**
+	* Expands all the ancestors of a node so that it is shown
+	* @return False if the node is not in the tree
+	*/
+	UFUNCTION(BlueprintCallable, Category = "TreeView|Expansion")
+	bool ExpandPath(int64 NodeId);
+
+	/** Expands or collapses the given nodes, ignoring the ones that are not in the tree */
+	UFUNCTION(BlueprintCallable, Category = "TreeView|Expansion")
+	void SetExpansion(const TArray<int64>& NodeIds, bool bExpanded);
+
+	/**
+	* Expands the ancestors of a node and scrolls its row to the middle of the tree, unless it is already in view
+	* @return False if the node is not in the tree or the filter hides it
+	*/
+	UFUNCTION(BlueprintCallable, Category = "TreeView|Rows")
+	bool ScrollToNode(int64 NodeId);
+
+	/**
+	* @return Row of a node among the rows the tree shows, -1 if it is not in the tree or a collapsed ancestor or the
+	* filter hides it. Rows are counted in logarithmic time, from an index updated as nodes are expanded and collapsed.
+	*/
+	UFUNCTION(BlueprintPure, Category = "TreeView|Rows")
+	int32 GetVisibleIndex(int64 NodeId) const;
+
+	/**
+	* Finds the node shown by a row in logarithmic time, the node above it for a loading row
+	* @return False past the last row
+	*/
+	UFUNCTION(BlueprintPure, Category = "TreeView|Rows")
+	bool NodeAtVisibleIndex(int32 VisibleIndex, FBTreeNodeHandle& Node) const;
+
+	/** @return Number of rows the tree shows, as if it were tall enough for all of them */
+	UFUNCTION(BlueprintPure, Category = "TreeView|Rows")
+	int32 GetNumVisibleRows() const;
+
+	/** Selects every node that is not hidden by the filter, requires MultiSelect */
+	UFUNCTION(BlueprintCallable, Category = "TreeView|Selection")
+	void SelectAll();
+
+	UFUNCTION(BlueprintCallable, Category = "TreeView|Selection")
+	void ClearSelection();
+
+	/** Selects or deselects the given nodes, ignoring the ones that are not in the tree. Without MultiSelect only the last one is selected. */
+	UFUNCTION(BlueprintCallable, Category = "TreeView|Selection")
+	void SetSelection(const TArray<int64>& NodeIds, bool bSelected);
+
+	/** Selects or deselects a node and all of its descendants that are not hidden by the filter, expanded or not */
+	UFUNCTION(BlueprintCallable, Category = "TreeView|Selection")
+	void SelectSubtree(int64 NodeId, bool bSelected = true);
+
+	UFUNCTION(BlueprintPure, Category = "TreeView|Selection")
+	bool IsNodeSelected(int64 NodeId) const;
+
+	UFUNCTION(BlueprintPure, Category = "TreeView|Selection")
+	int32 GetNumSelectedNodes() const;
+
+	UFUNCTION(BlueprintPure, Category = "TreeView|Selection")
+	void GetSelectedNodeIDs(TArray<int64>& NodeIds) const;
+
+	/**
+	* Adds a node to TreeNodes and to the tree without rebuilding it.
+	* @param NodeID	The NodeID of the new node
+	* @return False if the parent is not in the tree or the NodeID is already used
+	*/
+	UFUNCTION(BlueprintCallable, Category = "TreeView|Edit")
+	bool AddNode(const FBTreeNode& Node, int64& NodeID);
+
+	/** Removes a node and all of its descendants from the tree without rebuilding it */
+	UFUNCTION(BlueprintCallable, Category = "TreeView|Edit")
+	void RemoveSubtree(int64 NodeId);
+
+	/**
+	* Moves a node and its descendants under another parent without rebuilding the tree.
+	* @param NewParentID	The new parent, as in FBTreeNode::ParentID (0 makes the node a root)
+	* @return False if either node is not in the tree or the move would create a cycle
+	*/
+	UFUNCTION(BlueprintCallable, Category = "TreeView|Edit")
+	bool MoveNode(int64 NodeId, int64 NewParentID);
+
+	/**
+	* Moves nodes and their descendants under another parent in one change, keeping their order. TreeNodes keeps its order.
+	* @param BeforeNodeID	Child of the new parent the nodes are placed before, 0 placing them last. Ignored when the children are sorted.
+	* @return False if a node is not in the tree or the move would create a cycle, in which case nothing moves
+	*/
+	UFUNCTION(BlueprintCallable, Category = "TreeView|Edit")
+	bool MoveNodes(const TArray<int64>& NodeIds, int64 NewParentID, int64 BeforeNodeID = 0);
+
+	/** MoveNodes with node indices, BeforeIndex being INDEX_NONE or a child of NewParentIndex */
+	bool MoveNodeIndices(const TArray<int32>& NodeIndices, int32 NewParentIndex, int32 BeforeIndex);
+
+	/**
+	* Updates the name, padding and extra strings of the node with Node.NodeID and refreshes its row.
+	* Padding changes are applied the next time the row is generated.
+	*/
+	UFUNCTION(BlueprintCallable, Category = "TreeView|Edit")
+	void UpdateNode(const FBTreeNode& Node);
+
+	/**
+	* Sorts the children of every node, the roots included, and keeps them sorted. Nodes added later, moved or updated
+	* are placed among their sorted siblings rather than sorting them again. Equal nodes keep their order.
+	* @param ExtraStringIndex	Extra string to sort by, -1 for the name
+	*/
+	UFUNCTION(BlueprintCallable, Category = "TreeView|Sort")
+	void SetSortMode(EBTreeSortMode Mode, int32 ExtraStringIndex = -1, bool bDescending = false);
+
+	/**
+	* Sorts the nodes with a native comparator instead of SortMode, until SetSortMode is called.
+	* The comparator is called from several threads at once when the whole tree is sorted.
+	*/
+	void SetSortComparator(const FBTreeNodeLess& Less, bool bDescending = false);
+
+	/**
+	* Finds the nodes whose name contains the characters of Query in order, ignoring case, like quick-open dialogs.
+	* Names containing Query as a whole come first, then matches at word starts and in longer runs.
+	* @param NodeIds	Up to MaxResults nodes, best first
+	*/
+	UFUNCTION(BlueprintCallable, Category = "TreeView|Search")
+	void FindNodesByName(const FString& Query, int32 MaxResults, TArray<int64>& NodeIds);
+
+	/** @return False if no node has the NodeID */
+	UFUNCTION(BlueprintPure, Category = "TreeView|Node")
+	bool FindNodeHandle(int64 NodeId, FBTreeNodeHandle& Node) const;
+
+	/** @return False if the node was removed */
+	UFUNCTION(BlueprintPure, Category = "TreeView|Node")
+	bool IsValidNodeHandle(const FBTreeNodeHandle& Node) const;
+
+	/** Copies all the properties of a node, prefer the other GetNode functions for the ones that are needed */
+	UFUNCTION(BlueprintPure, Category = "TreeView|Node")
+	bool GetNodeData(const FBTreeNodeHandle& Node, FBTreeNode& Data) const;
+
+	UFUNCTION(BlueprintPure, Category = "TreeView|Node")
+	FString GetNodeName(const FBTreeNodeHandle& Node) const;
+
+	/** @return The ParentID of a node, as in FBTreeNode */
+	UFUNCTION(BlueprintPure, Category = "TreeView|Node")
+	int64 GetNodeParentID(const FBTreeNodeHandle& Node) const;
+
+	/** @return False for root nodes */
+	UFUNCTION(BlueprintPure, Category = "TreeView|Node")
+	bool GetNodeParent(const FBTreeNodeHandle& Node, FBTreeNodeHandle& Parent) const;
+
+	UFUNCTION(BlueprintPure, Category = "TreeView|Node")
+	int32 GetNodeNumChildren(const FBTreeNodeHandle& Node) const;
+
+	UFUNCTION(BlueprintPure, Category = "TreeView|Node")
+	void GetNodeChildren(const FBTreeNodeHandle& Node, TArray<FBTreeNodeHandle>& Children) const;
+
+	UFUNCTION(BlueprintPure, Category = "TreeView|Node")
+	int32 GetNodeNumExtraStrings(const FBTreeNodeHandle& Node) const;
+
+	/** @return The extra string at Index, empty if the node has no such string */
+	UFUNCTION(BlueprintPure, Category = "TreeView|Node")
+	FString GetNodeExtraString(const FBTreeNodeHandle& Node, int32 Index) const;
+
+	/** @return Number of ancestors of a node */
+	UFUNCTION(BlueprintPure, Category = "TreeView|Node")
+	int32 GetNodeDepth(const FBTreeNodeHandle& Node) const;
+
+	/**
+	* @return true if Ancestor is Node or one of its ancestors. This and the other subtree queries read an index of
+	* the tree that is rebuilt by the first query after nodes were added, removed or moved, and take constant time after that.
+	*/
+	UFUNCTION(BlueprintPure, Category = "TreeView|Node")
+	bool IsNodeAncestorOf(const FBTreeNodeHandle& Ancestor, const FBTreeNodeHandle& Node) const;
+
+	/** @return Number of nodes in the subtree of a node, counting the node itself, loaded lazy children only */
+	UFUNCTION(BlueprintPure, Category = "TreeView|Node")
+	int32 GetNodeSubtreeSize(const FBTreeNodeHandle& Node) const;
+
+	/**
+	* Finds the deepest node that is A or one of its ancestors and B or one of its ancestors, in logarithmic time
+	* @return False if the nodes have different roots
+	*/
+	UFUNCTION(BlueprintPure, Category = "TreeView|Node")
+	bool FindCommonAncestor(const FBTreeNodeHandle& A, const FBTreeNodeHandle& B, FBTreeNodeHandle& Ancestor) const;
+
+	/** Gets a node followed by all of its descendants, in the order they are shown when expanded */
+	UFUNCTION(BlueprintPure, Category = "TreeView|Node")
+	void GetSubtreeNodes(const FBTreeNodeHandle& Node, TArray<FBTreeNodeHandle>& Nodes) const;
+
+	/**
+	* @return The aggregate of Aggregates at AggregateIndex over the subtree of a node, 0 if there is no such aggregate.
+	* The aggregates are computed in one pass on the first call after the tree was built, and then kept up to date
+	* along the ancestors of the nodes that are added, removed, moved or updated, so that rows can read them cheaply.
+	*/
+	UFUNCTION(BlueprintPure, Category = "TreeView|Aggregates")
+	float GetNodeAggregate(const FBTreeNodeHandle& Node, int32 AggregateIndex) const;
+
+	/** @return Number of generated rows that reused a pooled row content widget */
+	UFUNCTION(BlueprintPure, Category = "TreeView|Row Content Pool")
+	int32 GetRowContentPoolHits() const;
+
+	/** @return Number of generated rows that had to create a new row content widget */
+	UFUNCTION(BlueprintPure, Category = "TreeView|Row Content Pool")
+	int32 GetRowContentPoolMisses() const;
+
+	/** @return Number of unused row content widgets currently held by the pool */
+	UFUNCTION(BlueprintPure, Category = "TreeView|Row Content Pool")
+	int32 GetNumPooledRowContents() const;
+
+	/** Releases every unused row content widget and resets the hit/miss counters */
+	UFUNCTION(BlueprintCallable, Category = "TreeView|Row Content Pool")
+	void EmptyRowContentPool();
+
+	/** @return The root above a node */
+	int32 GetRootIndex(int32 NodeIndex) const;
+
+	/** @return The row content class of a node, null for a plain text row */
+	UClass* GetRowContentClass(int32 NodeIndex);
+
+	/** @return The ParentID of a node of the node store, as used in FBTreeNode */
+	int64 GetParentNodeID(int32 NodeIndex) const;
+
+	/** @return A row content widget of the given class, reused from the pool when possible */
+	class UUserWidget* AcquireRowContent(UWorld* World, TSubclassOf<class UUserWidget> RowContentClass, bool& bOutReused);
 
-	int32 GetRootIndex(int32 nodeindex);
+	/** Gives a row content widget that is no longer shown back to the pool */
+	void ReleaseRowContent(class UUserWidget* RowWidget);
 
-	void HandleOnGenerateRow(TreeNodePtr Item, class UUserWidget* RowWidget, TArray<TreeNodePtr> Children);
+	void HandleOnGenerateRow(TreeNodePtr Item, class UUserWidget* RowWidget);
+	void HandleOnRowRebind(TreeNodePtr Item, class UUserWidget* RowWidget);
 	void HandleOnSelectionChanged(TreeNodePtr Item, class UUserWidget* RowWidget);
 	void HandleOnSelectionLost();
+	void HandleOnSelectionDelta(const FBSelectionDelta& Delta);
 	void HandleOnExpansionChanged(TreeNodePtr Item, class UUserWidget* RowWidget, bool ExpansionState);
 
+	/** Requests the children of lazy nodes on expansion and schedules their eviction on collapse */
+	void HandleOnLazyNodeExpansionChanged(int32 NodeIndex, bool ExpansionState);
+
+	/**
+	* Removes the provided children of nodes that stayed collapsed for LazyChildrenLifetime, their indices and strings
+	* being reused, so that browsing an unbounded hierarchy keeps memory bounded
+	*/
+	void EvictLazyChildren(double CurrentTime);
+
 protected:
 	TSharedPtr<SBCustomTreeView > TreeViewWidget;
-	TArray<TreeNodePtr> TreeStructure;
-	TArray<TreeNodePtr> TempStructure;
+
+	/** The nodes of the tree, keyed by NodeID */
+	TSharedPtr<FBTreeNodeStore> NodeStore;
+
+	/** Unused row content widgets, by row content class */
+	UPROPERTY(Transient)
+	TMap<UClass*, FBRowContentPool> RowContentPools;
+
+	int32 RowContentPoolHits;
+	int32 RowContentPoolMisses;
+
+	FBTreeBuildReport BuildReport;
+
+	/** Whether the tree was loaded from a snapshot or a directory rather than built from TreeNodes */
+	bool bExternalTree;
+
+	/** State of CreateTreeAsync */
+	FDelegateHandle TreeBuildTickerHandle;
+	int32 TreeBuildCursor;
+	int32 TreeBuildEnd;
+	int32 TreeBuildNumUsableNodes;
+	double TreeBuildStartTime;
+
+	/** Positions in TreeNodes of the nodes waiting for their parent to be built, by the NodeID of the parent */
+	TMultiMap<int64, int32> PendingTreeNodes;
+
+	bool TickTreeBuild(float DeltaTime);
+
+	/** Adds a node of TreeNodes to the store, or makes it wait for its parent */
+	void BuildTreeNode(int32 Position);
+
+	/** Reports the nodes still waiting for their parent and announces the tree */
+	void FinishTreeBuild();
+
+	/** Stops CreateTreeAsync and the directory source, if any */
+	void StopTreeBuild();
+
+	TSharedPtr<class FBDirectoryTreeSource> DirectorySource;
+	FDelegateHandle DirectorySourceTickerHandle;
+	bool bDirectoryScanComplete;
+
+	/** Adds the entries found by the directory source */
+	bool TickDirectorySource(float DeltaTime);
+
+	void LogBuildReport() const;
 
 	virtual TSharedRef<SWidget> RebuildWidget() override;
 
 	void EnsureWidgetValidity();
+
+	/**
+	* Resolves a ParentID as used in FBTreeNode
+	* @param OutParentIndex	Index of the parent in the node store, INDEX_NONE for roots
+	* @return False if the parent is not in the tree
+	*/
+	bool FindParentIndex(int64 ParentID, int32& OutParentIndex) const;
+
+	/** @return The entry of TreeNodes with the given NodeID, or null */
+	FBTreeNode* FindTreeNodeEntry(int64 NodeId);
+
+	/** Removes the entry of a removed node from TreeNodes */
+	void RemoveTreeNodeEntry(int64 NodeId);
+
+	/** Positions in TreeNodes by NodeID, only used with stable node ids */
+	TMap<int64, int32> TreeNodePositions;
+
+	/** RowContents arrays compiled by RefreshRowContentRules */
+	TMap<int64, UClass*> CompiledRowContentsById;
+	TMap<int64, UClass*> CompiledRowContentsByParent;
+	TArray<TPair<int32, TMap<FString, UClass*>>> CompiledRowContentsByExtraString;
+	TArray<UClass*> CompiledRowContentsByDepth;
+
+	/** Row content classes resolved so far, by node index */
+	TMap<int32, UClass*> CachedRowContents;
+
+	/** Drops the resolved row content classes, after the rules or the nodes they depend on changed */
+	void InvalidateRowContents();
+
+	/** Text of the filter, empty when every node is shown */
+	FString FilterText;
+	bool bFilterExtraStrings;
+
+	/** The filter result shown by the tree */
+	TSharedPtr<struct FBTreeFilterResult, ESPMode::ThreadSafe> FilterResult;
+
+	/** Filter running on the thread pool, reading the node store */
+	TFuture<TSharedPtr<struct FBTreeFilterResult, ESPMode::ThreadSafe>> PendingFilter;
+
+	FDelegateHandle FilterTickerHandle;
+
+	/** Set when the nodes changed since the filter was started */
+	bool bFilterStale;
+
+	void StartFilter();
+
+	/** Applies the pending filter once it is done, and starts another one if the text or the nodes changed meanwhile */
+	bool TickFilter(float DeltaTime);
+
+	/** Waits for the pending filter and applies it */
+	void CompleteFilter();
+
+	/** @return true while the pending filter is still reading the node store */
+	bool IsFilterRunning() const;
+
+	/** Waits for the pending filter before the node store is modified */
+	void WaitForFilter();
+
+	/** Filters the nodes again on the next tick, after they changed */
+	void InvalidateFilter();
+
+	/** Filters the nodes again right away, after the node store was rebuilt */
+	void RefreshFilter();
+
+	/** Sort applied to the node store, null when children keep their order */
+	TSharedPtr<FBTreeSort> Sort;
+
+	/** Comparator given to SetSortComparator */
+	FBTreeNodeLess NativeSortLess;
+
+	/** Nodes added by the current build tick or directory batch, placed among their sorted siblings at the end of it */
+	TArray<int32> UnsortedNodes;
+
+	/** Makes Sort from the sort settings and sorts the whole node store with it */
+	void ApplySort();
+
+	/** Places the UnsortedNodes among their sorted siblings */
+	void SortUnsortedNodes();
+
+	/** Sorts the node store again after the sort settings changed and refreshes the tree */
+	void ResortTree();
+
+	/** Aggregates computed from the Aggregates settings, null if there are none */
+	TSharedPtr<FBTreeAggregates> NodeAggregates;
+
+	/** Set when the node store was built or changed in bulk, NodeAggregates being computed again when next read */
+	mutable bool bAggregatesPending;
+
+	/** @return NodeAggregates if they are to be updated along with the node store, null if they are computed again anyway */
+	FBTreeAggregates* GetUpToDateAggregates() const;
+
+	/** Collapse time of the collapsed nodes that hold provided children, by node index */
+	TMap<int32, double> CollapsedLazyNodes;
+
+	void RequestLazyChildren(int32 NodeIndex);
+
+	/** Removes nodes from the store and everything that refers to them */
+	void RemoveStoreSubtree(int32 NodeIndex);
+
+	/**
+	* RemoveStoreSubtree for many subtrees at once, the rows being told once. The store reclaims the strings of the
+	* removed nodes, compacting its string buffers once they are mostly garbage.
+	*/
+	void RemoveStoreSubtrees(const TArray<int32>& NodeIndices);
+
+	FBTreeNodeHandle MakeNodeHandle(int32 NodeIndex) const;
+
+	/** @return The store index of the node of a handle, or INDEX_NONE if it was removed */
+	int32 ResolveNodeHandle(const FBTreeNodeHandle& Node) const;
+
+	/** Fills a Blueprint node struct from the node store */
+	void MakeTreeNode(int32 NodeIndex, FBTreeNode& OutNode) const;
+	void MakeTreeNodeChildren(int32 NodeIndex, TArray<FBTreeNode>& OutChildren) const;
 };
\ No newline at end of file
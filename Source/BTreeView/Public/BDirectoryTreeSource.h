@@ -0,0 +1,80 @@
+/// MIT License, Copyright Burak Kara, burak@burak.io, https://en.wikipedia.org/wiki/MIT_License
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Containers/Queue.h"
+
+/** A directory or file found by FBDirectoryTreeSource, or one that was removed from disk */
+struct FBDirectoryEntry
+{
+	int64 Key;
+	int64 ParentKey;
+	FString Name;
+	bool bDirectory;
+	bool bRemoved;
+};
+
+/**
+* Enumerates a directory tree on the thread pool, one task per directory, so parents are always found before
+* their children. The game thread pulls the entries in batches of a bounded number of entries of one directory, so that
+* it can stop between them once its time budget is spent, however large the directory.
+* In the editor, changes on disk are watched and reported as further entries.
+*/
+class FBDirectoryTreeSource
+{
+
+public:
+	FBDirectoryTreeSource(const FString& InRootPath, bool bInIncludeFiles);
+	~FBDirectoryTreeSource();
+
+	/** Starts enumerating the root directory, and watching it if requested and supported */
+	void Start(bool bWatchChanges);
+
+	/** Pops the next batch of entries. Game thread only. */
+	bool DequeueBatch(TArray<FBDirectoryEntry>& OutBatch);
+
+	/** @return true once every directory was enumerated and every batch dequeued */
+	bool IsScanComplete() const;
+
+	bool IsWatching() const;
+
+	/** @return The normalized path of the root directory */
+	const FString& GetRootPath() const
+	{
+		return RootPath;
+	}
+
+	/** @return The key of a node for a normalized path, never 0 */
+	static int64 MakeKey(const FString& Path);
+
+	/** @return A full path with forward slashes and no trailing slash */
+	static FString NormalizePath(const FString& Path);
+
+private:
+	/** State shared with the enumeration tasks, which may outlive the source */
+	struct FScanState
+	{
+		TQueue<TArray<FBDirectoryEntry>, EQueueMode::Mpsc> Batches;
+		FThreadSafeCounter PendingTasks;
+		FThreadSafeBool bCancelled;
+		bool bIncludeFiles;
+	};
+
+	/** Queues entries in batches of a bounded size, in order */
+	static void EnqueueBatches(FScanState& ScanState, const TArray<FBDirectoryEntry>& Entries);
+
+	/** Queues a task enumerating a directory */
+	static void ScanDirectoryAsync(const TSharedRef<FScanState, ESPMode::ThreadSafe>& ScanState, const FString& Path, int64 Key);
+
+	static void ScanDirectory(const TSharedRef<FScanState, ESPMode::ThreadSafe>& ScanState, const FString& Path, int64 Key);
+
+#if WITH_EDITOR
+	void OnDirectoryChanged(const TArray<struct FFileChangeData>& Changes);
+
+	FDelegateHandle WatcherHandle;
+#endif
+
+	FString RootPath;
+	TSharedRef<FScanState, ESPMode::ThreadSafe> State;
+};
@@ -0,0 +1,93 @@
+/// MIT License, Copyright Burak Kara, burak@burak.io, https://en.wikipedia.org/wiki/MIT_License
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class FBTreeNodeStore;
+
+/**
+* Values aggregated over the subtree of every node of a FBTreeNodeStore: the number of descendants, or the sum, least
+* or greatest of a numeric extra string. Every node keeps the aggregate of its subtree, computed children first in a
+* single walk and updated along the ancestors of the nodes that are added, removed, moved or updated, so reading it
+* takes constant time.
+*/
+class FBTreeAggregates
+{
+
+public:
+	enum class EOperation : uint8
+	{
+		Count,
+		Sum,
+		Min,
+		Max,
+	};
+
+	struct FAggregate
+	{
+		EOperation Operation;
+
+		/** Extra string holding the value of each node, unused by Count */
+		int32 ExtraStringIndex;
+	};
+
+	explicit FBTreeAggregates(const TArray<FAggregate>& InAggregates);
+
+	/** Computes the aggregates of every node without recursion, a node being added to its parent when the walk leaves it */
+	void Build(const FBTreeNodeStore& Store);
+
+	/** Adds a node that was just added to the store to the aggregates of its ancestors */
+	void AddNode(const FBTreeNodeStore& Store, int32 NodeIndex);
+
+	/** Adds a subtree that was moved to the aggregates of its new ancestors */
+	void LinkSubtree(const FBTreeNodeStore& Store, int32 NodeIndex);
+
+	/** Takes a subtree out of the aggregates of its ancestors, before it is removed or moved */
+	void UnlinkSubtree(const FBTreeNodeStore& Store, int32 NodeIndex);
+
+	/** Updates the aggregates of a node and its ancestors after its extra strings changed */
+	void UpdateNode(const FBTreeNodeStore& Store, int32 NodeIndex);
+
+	int32 Num() const
+	{
+		return Aggregates.Num();
+	}
+
+	/**
+	* @return The number of descendants of a node for Count, else the aggregate of the values of the node and its
+	* descendants, nodes without a numeric value being left out, or 0 if none of them has one
+	*/
+	double GetValue(int32 AggregateIndex, int32 NodeIndex) const;
+
+private:
+	struct FValues
+	{
+		FAggregate Aggregate;
+
+		/** Value of each node, by node index, the identity of the operation for nodes without a numeric value */
+		TArray<double> Own;
+
+		/** Own value of each node combined with the subtree values of its children */
+		TArray<double> Subtree;
+	};
+
+	TArray<FValues> Aggregates;
+
+	static double Combine(EOperation Operation, double A, double B);
+	static double GetIdentity(EOperation Operation);
+
+	double GetOwnValue(const FValues& Values, const FBTreeNodeStore& Store, int32 NodeIndex) const;
+
+	/** Combines a value into the subtree values of a node and its ancestors, Min and Max stopping at the first one left unchanged */
+	void AddToPath(FValues& Values, const FBTreeNodeStore& Store, int32 NodeIndex, double Value) const;
+
+	/** @return The own value of a node combined with the subtree values of its children, ExcludedChild left out */
+	double CombineChildren(const FValues& Values, const FBTreeNodeStore& Store, int32 NodeIndex, int32 ExcludedChild) const;
+
+	/**
+	* Recomputes the least or greatest value of a node from its children, ExcludedChild left out, and of its ancestors
+	* as long as it changes. An ancestor only reads its children again if the value it held is gone.
+	*/
+	void UpdateExtremes(FValues& Values, const FBTreeNodeStore& Store, int32 NodeIndex, int32 ExcludedChild) const;
+};
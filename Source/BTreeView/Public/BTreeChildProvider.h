@@ -0,0 +1,32 @@
+/// MIT License, Copyright Burak Kara, burak@burak.io, https://en.wikipedia.org/wiki/MIT_License
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/Interface.h"
+#include "BCustomTreeView.h"
+#include "BTreeChildProvider.generated.h"
+
+UINTERFACE(BlueprintType)
+class UBTreeChildProvider : public UInterface
+{
+	GENERATED_BODY()
+};
+
+/**
+* Supplies the children of tree nodes with HasLazyChildren, so hierarchies too large to build up front are
+* loaded as they are browsed.
+*/
+class IBTreeChildProvider
+{
+	GENERATED_BODY()
+
+public:
+	/**
+	* Called when a node with lazy children is expanded for the first time, or again after its children were evicted.
+	* The children are handed to TreeView->ProvideChildren, right away or once they are loaded.
+	* A loading row is shown under the node until then.
+	*/
+	UFUNCTION(BlueprintNativeEvent, BlueprintCallable, Category = "TreeView")
+	void RequestChildren(UBCustomTreeView* TreeView, const FBTreeNode& Node);
+};
@@ -0,0 +1,51 @@
+/// MIT License, Copyright Burak Kara, burak@burak.io, https://en.wikipedia.org/wiki/MIT_License
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Input/DragAndDrop.h"
+
+class FBTreeNodeStore;
+
+/** Nodes of a tree view dragged by the user, each along with its descendants */
+class FBTreeDragDropOp : public FDragDropOperation
+{
+
+public:
+	DRAG_DROP_OPERATOR_TYPE(FBTreeDragDropOp, FDragDropOperation)
+
+	/**
+	* @param InNodes	Dragged nodes. Nodes under another dragged node are left out, as they move along with it, and the
+	*					others are ordered as they are shown.
+	*/
+	static TSharedRef<FBTreeDragDropOp> New(const FBTreeNodeStore& Store, const TArray<int32>& InNodes);
+
+	/** @return true if a node is one of the dragged nodes or one of their descendants, so that nothing can be dropped onto it */
+	bool IsDragged(int32 NodeIndex) const
+	{
+		return DraggedSubtrees.IsValidIndex(NodeIndex) && DraggedSubtrees[NodeIndex];
+	}
+
+	const TArray<int32>& GetNodes() const
+	{
+		return Nodes;
+	}
+
+	/** @return true if the nodes were dragged from the given store, node indices meaning nothing in another one */
+	bool IsFromStore(const FBTreeNodeStore& InStore) const
+	{
+		return Store == &InStore;
+	}
+
+	/** FDragDropOperation interface */
+	virtual TSharedPtr<SWidget> GetDefaultDecorator() const override;
+
+private:
+	const FBTreeNodeStore* Store;
+	TArray<int32> Nodes;
+
+	/** Every node of the dragged subtrees, marked once when the drag starts so that each hovered row is tested in constant time */
+	TBitArray<> DraggedSubtrees;
+
+	FText Label;
+};
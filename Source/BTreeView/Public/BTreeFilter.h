@@ -0,0 +1,66 @@
+/// MIT License, Copyright Burak Kara, burak@burak.io, https://en.wikipedia.org/wiki/MIT_License
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Async/Future.h"
+
+class FBTreeNodeStore;
+
+/** A node whose name or extra strings contain the filter text */
+struct FBTreeNodeMatch
+{
+	int32 NodeIndex;
+	/** Index of the matching extra string, INDEX_NONE for the name */
+	int32 StringIndex;
+	/** Position of the filter text in the matching string */
+	int32 Start;
+};
+
+/** The nodes of a store matching a filter text */
+struct FBTreeFilterResult
+{
+	FString Text;
+	bool bMatchExtraStrings;
+
+	/** Matching nodes, by increasing node index */
+	TArray<FBTreeNodeMatch> Matches;
+
+	/** Nodes with a matching descendant, which have to be expanded to show the matches */
+	TArray<int32> Ancestors;
+
+	/** Matching nodes and their ancestors, by node index */
+	TBitArray<> VisibleNodes;
+
+	bool IsVisible(int32 NodeIndex) const
+	{
+		return VisibleNodes.IsValidIndex(NodeIndex) && VisibleNodes[NodeIndex];
+	}
+
+	/** @return The match of a node, or null if the node does not match */
+	const FBTreeNodeMatch* FindMatch(int32 NodeIndex) const;
+};
+
+typedef TSharedPtr<FBTreeFilterResult, ESPMode::ThreadSafe> FBTreeFilterResultPtr;
+
+/**
+* Matches the names, and optionally the extra strings, of the nodes of a store against a text, ignoring case.
+* Matching runs on the thread pool in parallel chunks of nodes.
+*/
+class FBTreeFilter
+{
+
+public:
+	/**
+	* Starts matching the nodes of a store. The store must not be modified until the result is ready.
+	* @param Previous	Result of an earlier query on the unmodified store. When Text contains its text, only its matches
+	*					can match again and the others are not tested.
+	*/
+	static TFuture<FBTreeFilterResultPtr> FilterAsync(const FBTreeNodeStore& Store, const FString& Text, bool bMatchExtraStrings, const FBTreeFilterResultPtr& Previous);
+
+	/** @return true if a node matches, filling OutMatch */
+	static bool MatchNode(const FBTreeNodeStore& Store, int32 NodeIndex, const FString& Text, bool bMatchExtraStrings, FBTreeNodeMatch& OutMatch);
+
+private:
+	static FBTreeFilterResultPtr Filter(const FBTreeNodeStore& Store, const FString& Text, bool bMatchExtraStrings, const FBTreeFilterResultPtr& Previous);
+};
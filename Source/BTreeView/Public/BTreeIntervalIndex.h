@@ -0,0 +1,84 @@
+/// MIT License, Copyright Burak Kara, burak@burak.io, https://en.wikipedia.org/wiki/MIT_License
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class FBTreeNodeStore;
+
+/**
+* Preorder numbering of the nodes of a FBTreeNodeStore. The descendants of a node are numbered right after it, so
+* whether a node is under another and how many nodes a subtree holds are read from two numbers, and every subtree
+* is a contiguous range of the order. Common ancestors are found with a segment tree of the depths along the order.
+* The store rebuilds the index on the first query after its hierarchy changed.
+*/
+class FBTreeIntervalIndex
+{
+
+public:
+	void Reset();
+
+	/** Numbers every node of the store, without recursion */
+	void Build(const FBTreeNodeStore& Store);
+
+	/** @return Position of a node in the preorder of the whole tree */
+	int32 GetPosition(int32 NodeIndex) const
+	{
+		return Positions[NodeIndex];
+	}
+
+	/** @return Number of nodes in the subtree of a node, counting the node itself */
+	int32 GetSubtreeSize(int32 NodeIndex) const
+	{
+		return SubtreeSizes[NodeIndex];
+	}
+
+	/** @return true if A is B or one of its ancestors */
+	bool IsAncestor(int32 A, int32 B) const
+	{
+		return Positions[A] <= Positions[B] && Positions[B] < Positions[A] + SubtreeSizes[A];
+	}
+
+	/** @return The node at a position of the preorder */
+	int32 GetNode(int32 Position) const
+	{
+		return Order[Position];
+	}
+
+	/** @return Number of nodes in the preorder */
+	int32 Num() const
+	{
+		return Order.Num();
+	}
+
+	/** @return A node followed by all of its descendants, in preorder */
+	TArrayView<const int32> GetSubtree(int32 NodeIndex) const
+	{
+		return TArrayView<const int32>(Order.GetData() + Positions[NodeIndex], SubtreeSizes[NodeIndex]);
+	}
+
+	/** @return The root above a node, found by a binary search of the root positions */
+	int32 GetRoot(int32 NodeIndex) const;
+
+	/** @return The deepest node that is A or one of its ancestors and B or one of its ancestors, INDEX_NONE if A and B have different roots */
+	int32 FindCommonAncestor(const FBTreeNodeStore& Store, int32 A, int32 B) const;
+
+	SIZE_T GetAllocatedSize() const;
+
+private:
+	/** Node indices in preorder */
+	TArray<int32> Order;
+
+	/** Position in Order and subtree size of each node, by node index */
+	TArray<int32> Positions;
+	TArray<int32> SubtreeSizes;
+
+	/** Positions of the roots, in increasing order */
+	TArray<int32> RootPositions;
+
+	/**
+	* Bottom-up segment tree over Order, leaf i being at Order.Num() + i. Entries are a depth in the high 32 bits and
+	* a position in the low ones, so the least entry of a range is its shallowest node.
+	*/
+	TArray<int64> DepthTree;
+};
@@ -0,0 +1,97 @@
+/// MIT License, Copyright Burak Kara, burak@burak.io, https://en.wikipedia.org/wiki/MIT_License
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class FBTreeNodeStore;
+
+/** A node found by FBTreeNameIndex::Query */
+struct FBTreeNameHit
+{
+	int32 NodeIndex;
+	int32 Score;
+};
+
+/**
+* Trigram index of the node names of a FBTreeNodeStore, kept up to date by the store as nodes are added, removed
+* and renamed. Every node is also listed under each character of its name and given a mask of them, which find the
+* candidates of a fuzzy query without reading every name.
+* Removed nodes only clear their mask, their trigram and character entries are dropped when enough of them piled up.
+*/
+class FBTreeNameIndex
+{
+
+public:
+	explicit FBTreeNameIndex(const FBTreeNodeStore& InStore);
+
+	void Reset();
+
+	/** Indexes every node of the store from scratch */
+	void Build();
+
+	void AddNode(int32 NodeIndex);
+	void RemoveNode(int32 NodeIndex);
+
+	/**
+	* Finds the nodes whose name contains the characters of QueryText in order, ignoring case, best first.
+	* Names containing QueryText as a whole are found through the trigrams and ranked first. The other names are only
+	* scored when fewer than MaxResults names contain it, only those holding every query character being read.
+	*/
+	void Query(const FString& QueryText, int32 MaxResults, TArray<FBTreeNameHit>& OutHits) const;
+
+	/** Finds the same nodes as Query without an index, reading the name of every node */
+	static void QueryStore(const FBTreeNodeStore& NodeStore, const FString& QueryText, int32 MaxResults, TArray<FBTreeNameHit>& OutHits);
+
+	/**
+	* Scores a name the way quick-open dialogs do: matches at word starts and runs of consecutive matches score
+	* higher, characters skipped before and between the matches lower the score.
+	* @param LowerQuery	The query in lower case
+	* @return The score, or -1 if the name does not contain the query characters in order
+	*/
+	static int32 ScoreName(const TCHAR* Name, const FString& LowerQuery);
+
+	SIZE_T GetAllocatedSize() const;
+
+private:
+	/** @return The key of the trigram starting at Chars, which must hold three lower case characters */
+	static uint64 MakeTrigram(const TCHAR* Chars)
+	{
+		return ((uint64)(Chars[0] & 0x1FFFFF) << 42) | ((uint64)(Chars[1] & 0x1FFFFF) << 21) | (uint64)(Chars[2] & 0x1FFFFF);
+	}
+
+	/** Bits of the character masks, the last bit of the 64 being set for every indexed node */
+	static const int32 NumCharBits = 63;
+
+	/** @return The bit of a character in the character masks, see CharMasks */
+	static int32 GetCharBit(TCHAR Char);
+
+	/** @return The character mask of a string, see CharMasks */
+	static uint64 MakeCharMask(const TCHAR* String);
+
+	/** Adds a candidate to a heap of the best MaxResults hits, each node being given at most once */
+	static void AddHit(TArray<FBTreeNameHit>& Hits, const FBTreeNameHit& Hit, int32 MaxResults);
+
+	/** Scores a node holding the query characters and adds it to the hits if it matches */
+	static void ScoreNode(const FBTreeNodeStore& NodeStore, int32 NodeIndex, const FString& LowerQuery, int32 MaxResults, TArray<FBTreeNameHit>& Hits);
+
+	/** Sorts the hits best first */
+	static void SortHits(TArray<FBTreeNameHit>& Hits);
+
+	const FBTreeNodeStore& Store;
+
+	/** Nodes whose name contains each trigram, possibly with nodes that were removed or renamed since */
+	TMap<uint64, TArray<int32>> Trigrams;
+
+	/** Nodes whose name contains a character of each bit of CharMasks, possibly with nodes that were removed or renamed since */
+	TArray<int32> CharNodes[NumCharBits];
+
+	/** One bit per letter, digit or group of other characters in the name of each node, 0 for nodes not indexed */
+	TArray<uint64> CharMasks;
+
+	/** Number of trigram and character entries of each node, to count the stale ones once it is removed */
+	TArray<int32> NumNodeEntries;
+
+	int32 NumEntries;
+	int32 NumStaleEntries;
+};
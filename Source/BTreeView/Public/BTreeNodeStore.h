@@ -0,0 +1,408 @@
+/// MIT License, Copyright Burak Kara, burak@burak.io, https://en.wikipedia.org/wiki/MIT_License
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Layout/Margin.h"
+#include "Templates/Atomic.h"
+#include "BTreeIntervalIndex.h"
+
+class IMappedFileHandle;
+class IMappedFileRegion;
+class FBTreeNameIndex;
+
+/** State flags kept for every node of a FBTreeNodeStore */
+namespace EBTreeNodeFlags
+{
+	enum Type : uint8
+	{
+		None = 0,
+		/** Children are requested from the child provider when the node is expanded */
+		LazyChildren = 1 << 0,
+		/** Children were requested and have not arrived yet */
+		ChildrenLoading = 1 << 1,
+		/** Children were provided, and will be evicted after the node stays collapsed for a while */
+		ChildrenLoaded = 1 << 2,
+	};
+}
+
+/**
+* Index-based storage for all the nodes of a tree.
+* The hierarchy is kept in parent/first-child/next-sibling index arrays and every node property lives in its
+* own array, so nodes are not individually allocated and traversals only touch the arrays they need.
+* Names and extra strings are stored null-terminated in a single character buffer and referenced by offset.
+* Replaced and removed strings are counted, and the buffer is compacted once they outweigh the strings in use.
+* Every node has a caller supplied 64-bit key that is mapped to its index, indices of removed nodes are reused.
+* A store can be saved to a binary snapshot and loaded back from it with memory mapping, see BTreeNodeStoreSnapshot.cpp.
+*/
+class FBTreeNodeStore
+{
+
+public:
+	FBTreeNodeStore();
+	~FBTreeNodeStore();
+
+	/** Removes all the nodes, reserving room for ExpectedNum nodes, ExpectedChars characters and ExpectedExtraStrings extra strings */
+	void Reset(int32 ExpectedNum = 0, int32 ExpectedChars = 0, int32 ExpectedExtraStrings = 0);
+
+	/**
+	* Adds a node as the last child of a parent
+	* @param Key			Unique key of the node
+	* @param ParentIndex	Index of the parent node, INDEX_NONE to add a root
+	* @param NodeFlags	EBTreeNodeFlags of the node
+	* @return Index of the new node, or INDEX_NONE if the key is already used
+	*/
+	int32 AddNode(int64 Key, int32 ParentIndex, const FString& Name, const FMargin& Padding, const TArray<FString>& ExtraStrings, uint8 NodeFlags = EBTreeNodeFlags::None);
+
+	/**
+	* Unlinks a node from the tree and removes it along with all of its descendants
+	* @param OutRemovedNodes	If set, receives the indices of all the removed nodes
+	*/
+	void RemoveSubtree(int32 Index, TArray<int32>* OutRemovedNodes = nullptr);
+
+	/**
+	* Makes a node a child of another parent, INDEX_NONE making it a root. The caller must prevent cycles.
+	* @param BeforeIndex	Child of the new parent the node is placed before, INDEX_NONE placing it last
+	*/
+	void MoveNode(int32 Index, int32 NewParentIndex, int32 BeforeIndex = INDEX_NONE);
+
+	/**
+	* Relinks the children of a node, or the roots if ParentIndex is INDEX_NONE, in a new order.
+	* Children must hold every current child exactly once. Groups of different parents may be relinked at the same time.
+	*/
+	void SetChildOrder(int32 ParentIndex, const TArray<int32>& Children);
+
+	void SetName(int32 Index, const FString& Name);
+	void SetPadding(int32 Index, const FMargin& Padding);
+	void SetExtraStrings(int32 Index, const TArray<FString>& ExtraStrings);
+
+	/** Sets the path on disk of a node, from which the paths of its descendants are derived */
+	void SetDirectoryPath(int32 Index, const FString& Path);
+
+	void SetFlags(int32 Index, uint8 NodeFlags)
+	{
+		Flags[Index] = NodeFlags;
+	}
+
+	/**
+	* Writes the nodes to a snapshot file, in depth-first order and without removed nodes or replaced strings
+	* @param UserFlags	Stored as is and returned by LoadSnapshot
+	*/
+	bool SaveSnapshot(const FString& Filename, uint32 UserFlags) const;
+
+	/**
+	* Replaces the nodes with the ones of a snapshot file. The file stays mapped and strings are read from it,
+	* the hierarchy columns are copied in bulk and the key lookup is built by the first call that needs it.
+	* Snapshots are only loaded on platforms with the same character size as the one that saved them.
+	* @return False if the file is missing or is not a valid snapshot, the store being left empty
+	*/
+	bool LoadSnapshot(const FString& Filename, uint32& OutUserFlags);
+
+	/** @return Number of node indices in use, including removed nodes */
+	int32 Num() const
+	{
+		return Parents.Num();
+	}
+
+	/** @return Number of nodes that are in the tree */
+	int32 NumNodes() const
+	{
+		return NumLiveNodes;
+	}
+
+	/** @return true if Index refers to a node that has not been removed */
+	bool IsValidNode(int32 Index) const
+	{
+		return Parents.IsValidIndex(Index) && LiveNodes[Index];
+	}
+
+	/** @return Whether each node index is in use, see IsValidNode */
+	const TBitArray<>& GetLiveNodes() const
+	{
+		return LiveNodes;
+	}
+
+	/** @return The index of the node with the given key, or INDEX_NONE */
+	int32 FindNode(int64 Key) const
+	{
+		EnsureKeyIndex();
+		const int32* Index = IndicesByKey.Find(Key);
+		return Index ? *Index : INDEX_NONE;
+	}
+
+	int64 GetKey(int32 Index) const
+	{
+		return Keys[Index];
+	}
+
+	/** @return The parent of a node or INDEX_NONE for roots */
+	int32 GetParent(int32 Index) const
+	{
+		return Parents[Index];
+	}
+
+	int32 GetFirstChild(int32 Index) const
+	{
+		return FirstChildren[Index];
+	}
+
+	int32 GetNextSibling(int32 Index) const
+	{
+		return NextSiblings[Index];
+	}
+
+	int32 GetPrevSibling(int32 Index) const
+	{
+		return PrevSiblings[Index];
+	}
+
+	int32 GetNumChildren(int32 Index) const
+	{
+		return NumChildren[Index];
+	}
+
+	int32 GetFirstRoot() const
+	{
+		return FirstRoot;
+	}
+
+	int32 GetNumRoots() const
+	{
+		return NumRoots;
+	}
+
+	/** @return Null-terminated name of a node, valid until the store is modified */
+	const TCHAR* GetName(int32 Index) const
+	{
+		return GetString(NameOffsets[Index]);
+	}
+
+	const FMargin& GetPadding(int32 Index) const
+	{
+		return Paddings[Index];
+	}
+
+	/** @return The EBTreeNodeFlags of a node */
+	uint8 GetFlags(int32 Index) const
+	{
+		return Flags[Index];
+	}
+
+	int32 GetNumExtraStrings(int32 Index) const
+	{
+		return ExtraStringCounts[Index];
+	}
+
+	/** @return Null-terminated extra string of a node, valid until the store is modified */
+	const TCHAR* GetExtraString(int32 Index, int32 StringIndex) const
+	{
+		return GetString(ExtraStringOffsets[ExtraStringStarts[Index] + StringIndex]);
+	}
+
+	/** Copies the extra strings of a node */
+	void GetExtraStrings(int32 Index, TArray<FString>& OutStrings) const;
+
+	/** @return The path of a node: the closest directory path set on it or an ancestor, followed by the names below it */
+	FString GetDirectoryPath(int32 Index) const;
+
+	/** @return true if a directory path was set on any node */
+	bool HasDirectoryPaths() const
+	{
+		return DirectoryPathOffsets.Num() > 0;
+	}
+
+	/** Appends the children of a node, or the roots if Index is INDEX_NONE, in order */
+	void GetChildren(int32 Index, TArray<int32>& OutChildren) const;
+
+	/** @return Number of ancestors of a node */
+	int32 GetDepth(int32 Index) const
+	{
+		return Depths[Index];
+	}
+
+	// Queries of the FBTreeIntervalIndex of the store, which the first one rebuilds after the hierarchy changed.
+	// They are not meant to run on several threads at once.
+
+	/** @return true if A is B or one of its ancestors */
+	bool IsAncestor(int32 A, int32 B) const
+	{
+		return GetIntervals().IsAncestor(A, B);
+	}
+
+	/** @return Number of nodes in the subtree of a node, counting the node itself */
+	int32 GetSubtreeSize(int32 Index) const
+	{
+		return GetIntervals().GetSubtreeSize(Index);
+	}
+
+	/** @return Position of a node in the depth-first order of the whole tree */
+	int32 GetPreorderPosition(int32 Index) const
+	{
+		return GetIntervals().GetPosition(Index);
+	}
+
+	/** @return The node at a position of the depth-first order of the whole tree */
+	int32 GetPreorderNode(int32 Position) const
+	{
+		return GetIntervals().GetNode(Position);
+	}
+
+	/** @return Number of nodes reached from the roots, in the depth-first order */
+	int32 GetNumPreorderNodes() const
+	{
+		return GetIntervals().Num();
+	}
+
+	/** @return A node followed by all of its descendants in depth-first order, valid until the store is modified */
+	TArrayView<const int32> GetSubtree(int32 Index) const
+	{
+		return GetIntervals().GetSubtree(Index);
+	}
+
+	int32 GetRoot(int32 Index) const
+	{
+		return GetIntervals().GetRoot(Index);
+	}
+
+	/** @return The deepest node that is A or one of its ancestors and B or one of its ancestors, INDEX_NONE if A and B have different roots */
+	int32 FindCommonAncestor(int32 A, int32 B) const
+	{
+		return GetIntervals().FindCommonAncestor(*this, A, B);
+	}
+
+	/**
+	* Keeps a FBTreeNameIndex of the node names up to date as nodes are added, removed and renamed,
+	* building it from the current nodes when it is enabled
+	*/
+	void SetNameIndexEnabled(bool bEnabled);
+
+	/** @return The name index, null unless enabled */
+	const FBTreeNameIndex* GetNameIndex() const
+	{
+		return NameIndex.Get();
+	}
+
+	/** @return Memory used by the store */
+	SIZE_T GetAllocatedSize() const;
+
+private:
+	/** Strings at offsets below NumMappedChars are in the mapped snapshot, the others in Chars */
+	const TCHAR* GetString(int32 Offset) const
+	{
+		return Offset < NumMappedChars ? MappedChars + Offset : &Chars[Offset - NumMappedChars];
+	}
+
+	const FBTreeIntervalIndex& GetIntervals() const
+	{
+		if (bIntervalsPending)
+		{
+			Intervals.Build(*this);
+			bIntervalsPending = false;
+		}
+		return Intervals;
+	}
+
+	/** Fills IndicesByKey if it was left empty by LoadSnapshot */
+	void EnsureKeyIndex() const
+	{
+		if (bKeyIndexPending)
+		{
+			BuildKeyIndex();
+		}
+	}
+
+	void BuildKeyIndex() const;
+
+	/** Releases the mapped snapshot, if any */
+	void ReleaseSnapshot();
+
+	/**
+	* @return true if every index and string offset read from a snapshot is in range, so that no query reads past its
+	* columns, and its links, child counts and depths make a forest in depth-first order, so that every walk ends
+	*/
+	bool ValidateSnapshot(int32 NumChars, const TArray<int32>& DirectoryPathNodes, const TArray<int32>& DirectoryPathOffsets) const;
+
+	/** Copies a string to the character buffer, returning its offset */
+	int32 AddString(const FString& String);
+
+	void AddExtraStrings(int32 Index, const TArray<FString>& ExtraStrings);
+
+	/** Counts a string that is no longer referenced as garbage, unless it is in the mapped snapshot */
+	void ReleaseString(int32 Offset);
+	void ReleaseExtraStrings(int32 Index);
+
+	/**
+	* Rewrites the strings in use to new buffers and remaps their offsets, once the garbage outweighs them.
+	* Strings of the mapped snapshot stay where they are.
+	*/
+	void CompactStringsIfNeeded();
+
+	/** Inserts a node in the children of a parent, or in the roots, before one of them or last */
+	void Link(int32 Index, int32 ParentIndex, int32 BeforeIndex = INDEX_NONE);
+
+	/** Removes a node from the children of its parent, or from the roots */
+	void Unlink(int32 Index);
+
+	TUniquePtr<FBTreeNameIndex> NameIndex;
+
+	/** Built on demand, bIntervalsPending being set by every change of the hierarchy. Atomic as SetChildOrder runs in parallel. */
+	mutable FBTreeIntervalIndex Intervals;
+	mutable TAtomic<bool> bIntervalsPending;
+
+	TArray<int64> Keys;
+	mutable TMap<int64, int32> IndicesByKey;
+	mutable bool bKeyIndexPending;
+
+	/** Indices of removed nodes, reused by AddNode */
+	TArray<int32> FreeIndices;
+
+	/** Hierarchy, INDEX_NONE where there is no such node */
+	TArray<int32> Parents;
+	TArray<int32> FirstChildren;
+	TArray<int32> LastChildren;
+	TArray<int32> NextSiblings;
+	TArray<int32> PrevSiblings;
+	TArray<int32> NumChildren;
+
+	/** Number of ancestors of each node, set when the node is linked and updated for its subtree when it moves */
+	TArray<int32> Depths;
+
+	/** Whether each node index is in use */
+	TBitArray<> LiveNodes;
+
+	/** Offsets of the node names in Chars */
+	TArray<int32> NameOffsets;
+
+	TArray<FMargin> Paddings;
+	TArray<uint8> Flags;
+
+	/** Offsets of directory paths in Chars, only for the nodes they were set on */
+	TMap<int32, int32> DirectoryPathOffsets;
+
+	/** Extra strings of node i are ExtraStringOffsets[ExtraStringStarts[i]] to ExtraStringOffsets[ExtraStringStarts[i] + ExtraStringCounts[i] - 1] */
+	TArray<int32> ExtraStringStarts;
+	TArray<int32> ExtraStringCounts;
+	TArray<int32> ExtraStringOffsets;
+
+	/** Null-terminated strings of all the nodes, starting with an empty string shared by every empty value */
+	TArray<TCHAR> Chars;
+
+	/** Characters of Chars and entries of ExtraStringOffsets that are no longer referenced */
+	int32 NumGarbageChars;
+	int32 NumGarbageExtraStrings;
+
+	/** String table of the loaded snapshot, which also starts with the shared empty string */
+	const TCHAR* MappedChars;
+	int32 NumMappedChars;
+
+	TUniquePtr<IMappedFileHandle> SnapshotFile;
+	TUniquePtr<IMappedFileRegion> SnapshotRegion;
+
+	/** Contents of the snapshot when the platform cannot map files */
+	TArray<uint8> SnapshotData;
+
+	int32 FirstRoot;
+	int32 LastRoot;
+	int32 NumRoots;
+	int32 NumLiveNodes;
+};
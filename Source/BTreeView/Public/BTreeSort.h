@@ -0,0 +1,69 @@
+/// MIT License, Copyright Burak Kara, burak@burak.io, https://en.wikipedia.org/wiki/MIT_License
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class FBTreeNodeStore;
+
+/** @return true if node A goes before node B. Called from several threads at once by FBTreeSort::SortAll. */
+typedef TFunction<bool(const FBTreeNodeStore& Store, int32 A, int32 B)> FBTreeNodeLess;
+
+/**
+* Orders the children of every node of a FBTreeNodeStore, and the roots, by relinking their sibling lists.
+* Nodes are compared by their name or one of their extra strings, or by a native comparator, and nodes comparing
+* equal keep their order. Before a group of siblings is sorted, the first characters of each string are packed
+* into an integer, so that most comparisons do not read the strings.
+*/
+class FBTreeSort
+{
+
+public:
+	/**
+	* @param bInNatural			Compare runs of digits by their value, so that "Item 9" comes before "Item 10"
+	* @param InExtraStringIndex	Extra string to compare, INDEX_NONE for the name. Nodes without it compare as an empty string.
+	*/
+	FBTreeSort(bool bInNatural, int32 InExtraStringIndex, bool bInDescending);
+	FBTreeSort(const FBTreeNodeLess& InLess, bool bInDescending);
+
+	/** Sorts every group of siblings, the groups in parallel */
+	void SortAll(FBTreeNodeStore& Store) const;
+
+	/** Sorts the children of a node, or the roots if ParentIndex is INDEX_NONE */
+	void SortChildren(FBTreeNodeStore& Store, int32 ParentIndex) const;
+
+	/**
+	* Moves nodes that were added, moved or renamed to their place among their siblings, which must be sorted otherwise.
+	* Each node is placed with a binary search, unless it is a large part of its siblings and sorting them is cheaper.
+	*/
+	void InsertSorted(FBTreeNodeStore& Store, const TArray<int32>& Nodes) const;
+
+	/** @return true if node A goes before node B */
+	bool Less(const FBTreeNodeStore& Store, int32 A, int32 B) const;
+
+private:
+	/** A node with the string it is sorted by */
+	struct FSortKey
+	{
+		/** The first characters of the string in lower case, 16 bits each */
+		uint64 Prefix;
+		const TCHAR* String;
+		int32 NodeIndex;
+	};
+
+	FSortKey MakeSortKey(const FBTreeNodeStore& Store, int32 NodeIndex) const;
+	bool KeyLess(const FSortKey& A, const FSortKey& B) const;
+
+	/** Sorts a group of siblings and relinks them in that order */
+	void SortGroup(FBTreeNodeStore& Store, int32 ParentIndex, TArray<int32>& Children) const;
+
+	/** @return <0, 0 or >0 as A goes before, with or after B, ignoring case and comparing runs of digits by value if bCompareNumbers */
+	static int32 CompareStrings(const TCHAR* A, const TCHAR* B, bool bCompareNumbers);
+
+	bool bNatural;
+	int32 ExtraStringIndex;
+	bool bDescending;
+
+	/** Replaces the string comparison when set */
+	FBTreeNodeLess NativeLess;
+};
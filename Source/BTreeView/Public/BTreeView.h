@@ -4,6 +4,8 @@
 
 #include "Modules/ModuleManager.h"
 
+DECLARE_LOG_CATEGORY_EXTERN(LogBTreeView, Log, All);
+
 class FBTreeViewModule : public IModuleInterface
 {
 
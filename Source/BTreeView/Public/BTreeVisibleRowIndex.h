@@ -0,0 +1,66 @@
+/// MIT License, Copyright Burak Kara, burak@burak.io, https://en.wikipedia.org/wiki/MIT_License
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class FBTreeNodeStore;
+
+/**
+* Rows of a tree view, over the preorder of its FBTreeNodeStore. Each position of the order holds the number of
+* collapsed ancestors of its node, plus one if the filter hides it, and the nodes at 0 are the rows. A segment tree
+* keeps the least count of every range with the number of rows at it, so expanding or collapsing a node adds to the
+* range of its descendants, and both the row of a node and the node of a row are found in logarithmic time.
+*/
+class FBTreeVisibleRowIndex
+{
+
+public:
+	void Reset();
+
+	/**
+	* @param ExpandedNodes	Expansion state of the nodes, by node index
+	* @param VisibleNodes	Nodes the filter shows, by node index, or null if it shows every node
+	*/
+	void Build(const FBTreeNodeStore& Store, const TBitArray<>& ExpandedNodes, const TBitArray<>* VisibleNodes);
+
+	/**
+	* Shows or hides the descendants of a node after it was expanded or collapsed
+	* @param bPlaceholder	The node shows a loading row while expanded, as its lazy children are not loaded yet
+	*/
+	void SetExpansion(const FBTreeNodeStore& Store, int32 NodeIndex, bool bExpanded, bool bPlaceholder);
+
+	/** @return Row of a node, INDEX_NONE if a collapsed ancestor or the filter hides it */
+	int32 GetRow(const FBTreeNodeStore& Store, int32 NodeIndex) const;
+
+	/** @return Node shown by a row, the node above it for a loading row, INDEX_NONE past the last row */
+	int32 GetRowNode(const FBTreeNodeStore& Store, int32 Row) const;
+
+	int32 GetNumRows() const
+	{
+		return Entries.Num() > 0 && Entries[1].Min == 0 ? Entries[1].NumRows : 0;
+	}
+
+private:
+	struct FEntry
+	{
+		/** Least count of the range, Pending included */
+		int32 Min;
+
+		/** Rows of the positions of the range at Min, a node with a loading row taking two */
+		int32 NumRows;
+
+		/** Added to the whole range and not yet to the entries below */
+		int32 Pending;
+	};
+
+	/** Entry 1 is the root, the children of entry i are 2i and 2i + 1, and position p is entry NumLeaves + p */
+	TArray<FEntry> Entries;
+	int32 NumLeaves;
+
+	/** Adds Value to the counts of the positions in [First, Last), below an entry covering [Low, High) */
+	void AddToRange(int32 Entry, int32 Low, int32 High, int32 First, int32 Last, int32 Value);
+
+	/** Recomputes an entry from its children */
+	void UpdateEntry(int32 Entry);
+};
@@ -55,6 +55,8 @@ public:
 	DECLARE_DELEGATE_RetVal_ThreeParams(TOptional<EItemDropZone>, FOnCanAcceptDrop, const FDragDropEvent&, EItemDropZone, ItemType);
 	/** Delegate signature for handling the drop of FDragDropEvent onto target of type ItemType */
 	DECLARE_DELEGATE_RetVal_ThreeParams(FReply, FOnAcceptDrop, const FDragDropEvent&, EItemDropZone, ItemType);
+	/** Delegate signature for expanding or collapsing an item and all of its descendants */
+	DECLARE_DELEGATE_TwoParams(FOnExpanderShiftClicked, ItemType, bool);
 
 	SLATE_BEGIN_ARGS(SBAdvancedTableRow< ItemType >)
 		: _Style(&FCoreStyle::Get().GetWidgetStyle<FTableRowStyle>("TableView.Row"))
@@ -92,11 +94,18 @@ public:
 	SLATE_EVENT(FOnTableRowDragLeave, OnDragLeave)
 	SLATE_EVENT(FOnTableRowDrop, OnDrop)
 
+	/** Expands or collapses the subtree of the row when its expander is shift-clicked, instead of the owner table */
+	SLATE_EVENT(FOnExpanderShiftClicked, OnExpanderShiftClicked)
+
 	SLATE_ATTRIBUTE(FMargin, Padding)
 	SLATE_ATTRIBUTE( bool, ExpanderVisibility)
 
 	SLATE_ARGUMENT(bool, ShowSelection)
 
+	/** Cells shown after the content in a multi-column tree, the expander, indentation and content then being given TreeColumnWidth */
+	SLATE_ARGUMENT(TSharedPtr<SWidget>, Cells)
+	SLATE_ATTRIBUTE(FOptionalSize, TreeColumnWidth)
+
 	SLATE_DEFAULT_SLOT(typename SBAdvancedTableRow<ItemType>::FArguments, Content)
 
 	SLATE_END_ARGS()
@@ -108,48 +117,50 @@ public:
 		InnerContentSlot = nullptr;
 
 		SHorizontalBox::FSlot* InnerContentSlotNativePtr = nullptr;
-		if (InExpanderVisibility)
+		TSharedRef<SWidget> Expander = InExpanderVisibility
+			? StaticCastSharedRef<SWidget>(SNew(SBTreeExpanderArrow, SharedThis(this)).StyleSet(ExpanderStyleSet))
+			: StaticCastSharedRef<SWidget>(SNew(SSpacer));
+
+		TSharedRef<SWidget> TreeColumn = SNew(SHorizontalBox)
+			+ SHorizontalBox::Slot().AutoWidth().HAlign(HAlign_Right).VAlign(VAlign_Fill)
+			[
+				Expander
+			]
+			+ SHorizontalBox::Slot()
+			.FillWidth(1)
+			.Expose(InnerContentSlotNativePtr)
+			.Padding(InPadding)
+			[
+				InContent
+			];
+
+		if (Cells.IsValid())
 		{
 			this->ChildSlot
 				[
 					SNew(SHorizontalBox)
-					+ SHorizontalBox::Slot().AutoWidth().HAlign(HAlign_Right).VAlign(VAlign_Fill)
+					+ SHorizontalBox::Slot().AutoWidth()
 				[
-					SNew(SBTreeExpanderArrow, SharedThis(this))
-					.StyleSet(ExpanderStyleSet)
+					SNew(SBox).WidthOverride(TreeColumnWidth)
+					[
+						TreeColumn
+					]
 				]
-
-			+ SHorizontalBox::Slot()
-				.FillWidth(1)
-				.Expose(InnerContentSlotNativePtr)
-				.Padding(InPadding)
+			+ SHorizontalBox::Slot().AutoWidth()
 				[
-					InContent
+					Cells.ToSharedRef()
 				]
 				];
-
-			InnerContentSlot = InnerContentSlotNativePtr;
 		}
 		else
 		{
 			this->ChildSlot
 				[
-					SNew(SHorizontalBox)
-					+ SHorizontalBox::Slot().AutoWidth().HAlign(HAlign_Right).VAlign(VAlign_Fill)
-				[
-					SNew(SSpacer)
-				]
-			+ SHorizontalBox::Slot()
-				.FillWidth(1)
-				.Expose(InnerContentSlotNativePtr)
-				.Padding(InPadding)
-				[
-					InContent
-				]
+					TreeColumn
 				];
-
-			InnerContentSlot = InnerContentSlotNativePtr;
 		}
+
+		InnerContentSlot = InnerContentSlotNativePtr;
 	}
 
 	/**
@@ -707,7 +718,14 @@ public:
 		{
 			ItemType MyItem = *(OwnerWidget->Private_ItemFromWidget(this));
 			const bool IsItemExpanded = bItemHasChildren && OwnerWidget->Private_IsItemExpanded(MyItem);
-			OwnerWidget->Private_OnExpanderArrowShiftClicked(MyItem, !IsItemExpanded);
+			if (OnExpanderShiftClicked_Handler.IsBound())
+			{
+				OnExpanderShiftClicked_Handler.Execute(MyItem, !IsItemExpanded);
+			}
+			else
+			{
+				OwnerWidget->Private_OnExpanderArrowShiftClicked(MyItem, !IsItemExpanded);
+			}
 		}
 	}
 
@@ -839,10 +857,13 @@ protected:
 		this->OnDragEnter_Handler = InArgs._OnDragEnter;
 		this->OnDragLeave_Handler = InArgs._OnDragLeave;
 		this->OnDrop_Handler = InArgs._OnDrop;
+		this->OnExpanderShiftClicked_Handler = InArgs._OnExpanderShiftClicked;
 
 		this->SetOwnerTableView(InOwnerTableView);
 
 		this->bShowSelection = InArgs._ShowSelection;
+		this->Cells = InArgs._Cells;
+		this->TreeColumnWidth = InArgs._TreeColumnWidth;
 	}
 
 	void SetOwnerTableView(TSharedPtr<STableViewBase> OwnerTableView)
@@ -916,9 +937,18 @@ protected:
 	/** Delegate triggered when a user's drag is dropped in the bounds of this list item */
 	FOnTableRowDrop OnDrop_Handler;
 
+	/** Delegate triggered when the expander arrow is shift-clicked */
+	FOnExpanderShiftClicked OnExpanderShiftClicked_Handler;
+
 	/** The slot that contains the inner content for this row. If this is set, SetContent populates this slot with the new content rather than replace the content wholesale */
 	FSlotBase* InnerContentSlot;
 
+	/** Cells shown after the tree column, null outside of multi-column trees */
+	TSharedPtr<SWidget> Cells;
+
+	/** Width of the expander, indentation and content when there are Cells */
+	TAttribute<FOptionalSize> TreeColumnWidth;
+
 	/** The widget in the content slot for this row */
 	TWeakPtr<SWidget> Content;
 
@@ -3,19 +3,27 @@
 #pragma once
 
 #include "BCustomTreeNode.h"
+#include "BTreeNodeStore.h"
+#include "BTreeFilter.h"
+#include "SBTreeView.h"
+#include "SBTreeRowCells.h"
+#include "BTreeVisibleRowIndex.h"
 #include "SlateCore.h"
 #include "Engine.h"
 #include "BTreeViewStyles.h"
 
-typedef STreeView<TreeNodePtr> STView;
-
 struct FRow
 {
-	int32 NodeId;
+	int32 NodeIndex;
 	class UUserWidget* RowWidget;
+	TWeakPtr<ITableRow> TableRow;
+	/** Text shown by the row when it has no row content widget */
+	TWeakPtr<STextBlock> TextBlock;
+	/** Cells of the other columns in a multi-column tree */
+	TWeakPtr<SBTreeRowCells> Cells;
 };
 
-class SBCustomTreeView : public SCompoundWidget
+class SBCustomTreeView : public SCompoundWidget, public FGCObject
 {
 
 public:
@@ -24,6 +32,7 @@ public:
 	SLATE_ARGUMENT(TWeakObjectPtr<class UBCustomTreeView>, TWidget)
 	SLATE_ARGUMENT(const struct FBTreeViewStyle*, TStyle)
 	SLATE_ARGUMENT(bool , ExpanderVisibility)
+	SLATE_ARGUMENT(TSharedPtr<FBTreeNodeStore>, NodeStore)
 
 	SLATE_ARGUMENT(const struct FBExpandedArrowStyle*, ExpandedArrowStyle)
 	//SLATE_ARGUMENT(TArray<const struct FRowContentType>*, RowContents)
@@ -41,36 +50,208 @@ public:
 	/** @return Returns true if the specified item is currently expanded in the tree */
 	bool IsItemExpanded(const TreeNodePtr Item) const;
 
-	void RefreshTree(TArray< TreeNodePtr > structure);
+	/** Re-reads the roots from the node store and refreshes the tree after its hierarchy changed */
+	void RefreshTree();
+
+	/** Drops every node handle after the node store was rebuilt, then refreshes the tree */
+	void RebuildTree();
+
 	void ExpandTreeItem(TreeNodePtr Item);
 	void CollapseTreeItem(TreeNodePtr Item);
 	void ToggleNodeExpansion(TreeNodePtr Item);
+
+	/**
+	* Expands or collapses many nodes at once. TView only marks itself dirty when an item changes,
+	* so the whole batch is relinearized once, on its next tick.
+	*/
+	void SetNodesExpansion(const TArray<int32>& NodeIndices, bool bExpand);
+
+	/** Expands every node that has children, leaving lazy children that were not loaded yet alone */
+	void ExpandAll();
+
+	void CollapseAll();
+
+	/** Expands the nodes above Depth and collapses the others, showing Depth + 1 levels of the tree */
+	void ExpandToDepth(int32 Depth);
+
+	/** Expands the ancestors of a node so that it is shown */
+	void ExpandPath(int32 NodeIndex);
+
+	/** Expands or collapses a node and all of its descendants, walking the node store without recursion */
+	void SetSubtreeExpansion(int32 NodeIndex, bool bExpand);
+
+	/**
+	* @return Row of a node among the rows the tree shows, INDEX_NONE if a collapsed ancestor or the filter hides it.
+	* Rows are counted by a FBTreeVisibleRowIndex, which is rebuilt after the tree is refreshed and updated as nodes
+	* are expanded and collapsed, without linearizing the tree.
+	*/
+	int32 GetVisibleIndex(int32 NodeIndex);
+
+	/** @return Node shown by a row, the node above it for a loading row, INDEX_NONE past the last row */
+	int32 GetNodeAtVisibleIndex(int32 VisibleIndex);
+
+	int32 GetNumVisibleRows();
+
+	/** Expands the ancestors of a node and scrolls its row to the middle of the tree, unless it is already in view */
+	void ScrollToNode(int32 NodeIndex);
+
+	/** Selects every node that is not hidden by the filter, a word at a time. Only with multiple selection. */
+	void SelectAll();
+
+	/** Selects or deselects a node and all of its descendants, collapsed or not, leaving out the ones hidden by the filter */
+	void SetSubtreeSelection(int32 NodeIndex, bool bSelect);
+
+	void SetNodesSelection(const TArray<int32>& NodeIndices, bool bSelect);
+
+	void ClearSelection();
+
+	bool IsNodeSelected(int32 NodeIndex) const;
+
+	/** @return Whether each node is selected, by node index */
+	const TBitArray<>& GetSelectedNodes() const;
+
+	int32 GetNumSelectedNodes() const;
+
+	/** Updates the generated row of a node whose data changed, if it has one */
+	void RefreshTreeItem(int32 NodeIndex);
+
+	/** @return The handle given to the tree view for a node, created on first use */
+	TreeNodePtr GetNodeHandle(int32 NodeIndex);
+
+	/** Invalidates the handles of nodes that were removed from the node store */
+	void OnNodesRemoved(const TArray<int32>& RemovedNodes);
+
+	/** Shows only the visible nodes of a filter result, or every node if it is null */
+	void SetFilter(const FBTreeFilterResultPtr& InFilter);
+
+	/** Remembers the expanded nodes by key before a filter expands the ancestors of its matches */
+	void SaveFilterExpansion();
+
+	/** Collapses the nodes expanded since SaveFilterExpansion and expands the remembered ones that are still in the store */
+	void RestoreFilterExpansion();
+
+	/**
+	* Remembers the expanded and selected nodes by key, and the scroll offset, before the node store is rebuilt.
+	* Nodes still waiting from a previous save are kept.
+	*/
+	void SaveViewState();
+
+	/**
+	* Expands and selects the saved nodes that are in the node store again, without calling the widget events.
+	* @param bFinal	Drop the saved nodes that were not found and restore the scroll offset, once the store is complete
+	*/
+	void RestoreViewState(bool bFinal);
 	
 	TWeakObjectPtr<class UBCustomTreeView> TWidget;
 	const struct FBTreeViewStyle* TStyle;
 	const struct FBExpandedArrowStyle* ExpandedArrowStyle;
 	bool ExpanderVisibility;
-	TArray<FRow> Rows;
+
+	/** @return The live row showing the given node, or null if the node has no generated row */
+	const FRow* FindRow(int32 NodeIndex) const;
+
+	/** FGCObject interface */
+	virtual void AddReferencedObjects(FReferenceCollector& Collector) override;
+	virtual FString GetReferencerName() const override;
 
 protected:
 	TSharedRef<ITableRow> OnGenerateRow(TreeNodePtr Item, const TSharedRef<STableViewBase>& OwnerTable);
 
 	TSharedPtr<SScrollBar> ExternalScrollbar();
 
+	/** Makes the header of the columns of the widget and their layout, or returns null if it has no columns */
+	TSharedPtr<SHeaderRow> MakeHeaderRow();
+
+	FOptionalSize GetTreeColumnSize() const;
+	float GetTreeColumnWidth() const;
+	float GetColumnWidth(int32 Column) const;
+	void OnTreeColumnResized(float Width);
+	void OnColumnResized(float Width, int32 Column);
+
+	/** Removes a row released by TView from the row registry and returns its content widget to the pool, the only place it is returned */
+	void OnRowReleased(const TSharedRef<ITableRow>& TableRow);
+
 	void OnGetChildren(TreeNodePtr Item, TArray< TreeNodePtr >& OutChildren);
 
-	void OnSelectionChanged(TreeNodePtr Item, ESelectInfo::Type SelectInfo);
+	/** Row drag and drop, with AllowDragAndDrop */
+	FReply OnRowDragDetected(const FGeometry& MyGeometry, const FPointerEvent& MouseEvent, TreeNodePtr Item);
+	TOptional<EItemDropZone> OnRowCanAcceptDrop(const FDragDropEvent& DragDropEvent, EItemDropZone DropZone, TreeNodePtr Item);
+	FReply OnRowAcceptDrop(const FDragDropEvent& DragDropEvent, EItemDropZone DropZone, TreeNodePtr Item);
+
+	/** Called by TView once per frame when the selection changed */
+	void OnSelectionDelta(const FBSelectionDelta& Delta);
 
 	void OnExpansionChanged(TreeNodePtr Item, bool ExpansionState);
 
+	void OnExpanderShiftClicked(TreeNodePtr Item, bool bExpand);
+
 	/** SWidget overrides */
 	virtual void Tick(const FGeometry& AllottedGeometry, const double InCurrentTime, const float InDeltaTime) override;
 
 private:
+	/** Handles of the root nodes, the items source of TView */
 	TArray< TreeNodePtr > TreeStructure;
+
+	TSharedPtr<FBTreeNodeStore> NodeStore;
+
+	/** Handles created for the nodes TView asked for, by node index */
+	TMap<int32, TreeNodePtr> NodeHandles;
+
+	/** Loading rows of the nodes whose lazy children are not loaded yet, by node index */
+	TMap<int32, TreeNodePtr> PlaceholderHandles;
+
+	TreeNodePtr GetPlaceholderHandle(int32 NodeIndex);
+
+	/** @return true if a node is not hidden by the filter */
+	bool IsNodeShown(int32 NodeIndex) const
+	{
+		return !Filter.IsValid() || Filter->IsVisible(NodeIndex);
+	}
+
+	/** @return The text highlighted in the text rows */
+	FText GetHighlightText() const;
+
+	/** The applied filter, null when every node is shown */
+	FBTreeFilterResultPtr Filter;
+	FText HighlightText;
+
+	/** Expansion state of the nodes, by node index */
+	TBitArray<> ExpandedNodes;
+
+	/** Rows of the expanded tree, rebuilt on first use when bVisibleRowsPending */
+	FBTreeVisibleRowIndex VisibleRows;
+	bool bVisibleRowsPending;
+
+	FBTreeVisibleRowIndex& GetVisibleRows();
+
+	/** Keys of the nodes expanded before the filter, see SaveFilterExpansion */
+	TSet<int64> FilterExpandedKeys;
+	bool bHasFilterExpansion;
+
+	/** Keys of the nodes to expand and select again after the node store is rebuilt */
+	TSet<int64> SavedExpandedKeys;
+	TSet<int64> SavedSelectedKeys;
+	float SavedScrollOffset;
+	bool bHasSavedViewState;
+
+	/** Set while the saved view state is applied, so that it is not reported as a change */
+	bool bRestoringViewState;
+
+	/** Whether TView selects many nodes, read from the widget when constructed */
+	bool bMultiSelect;
+
+	/** Column widths shared with the rows, null unless the tree has columns */
+	TSharedPtr<FBTreeColumnLayout> ColumnLayout;
+
+	/** Live row of each node, by node index, the entry of a removed node or of a replaced row being dropped at once */
+	TMap<int32, FRow> Rows;
+
+	/** Every row generated by TView and not released yet, by row widget. They own their content widgets. */
+	TMap<const ITableRow*, FRow> TableRows;
 	/** The tree view widget*/
-	TSharedPtr< STView > TView;
-	TSharedPtr< SScrollBox > verticalscrollbox;
+	TSharedPtr< SBTreeView > TView;
+	/** The styled scrollbar driving TView, placed next to it */
+	TSharedPtr< SScrollBar > ScrollBar;
 	FGeometry CachedGeometry;
 	float currentscrolldisremaining;
 };
@@ -0,0 +1,57 @@
+/// MIT License, Copyright Burak Kara, burak@burak.io, https://en.wikipedia.org/wiki/MIT_License
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "SlateCore.h"
+#include "SlateBasics.h"
+
+class FBTreeNodeStore;
+
+/** Columns of a multi-column tree view, shared by its header and its rows so that resizing a column moves every row */
+struct FBTreeColumnLayout
+{
+	/** Width of the first column, holding the expander and the row content */
+	float TreeColumnWidth;
+
+	/** Extra string shown in each of the other columns, INDEX_NONE for the name */
+	TArray<int32> ExtraStringIndices;
+	TArray<float> Widths;
+};
+
+/**
+* Text cells of a node for the columns after the first one. The cells are painted as text elements rather than
+* made of child widgets, and only the ones inside the clipping rect are painted, so wide trees cost the same
+* per row as narrow ones.
+*/
+class SBTreeRowCells : public SLeafWidget
+{
+
+public:
+	SLATE_BEGIN_ARGS(SBTreeRowCells)
+		: _TextStyle(&FCoreStyle::Get().GetWidgetStyle<FTextBlockStyle>("NormalText"))
+		, _CellPadding(FMargin(4.0f, 0.0f))
+	{}
+	SLATE_ARGUMENT(TSharedPtr<const FBTreeColumnLayout>, Layout)
+	SLATE_STYLE_ARGUMENT(FTextBlockStyle, TextStyle)
+	SLATE_ARGUMENT(FMargin, CellPadding)
+	SLATE_END_ARGS()
+
+	void Construct(const FArguments& InArgs, const FBTreeNodeStore& Store, int32 NodeIndex);
+
+	/** Reads the strings of the node again after it changed */
+	void Refresh(const FBTreeNodeStore& Store, int32 NodeIndex);
+
+	/** SWidget overrides */
+	virtual int32 OnPaint(const FPaintArgs& Args, const FGeometry& AllottedGeometry, const FSlateRect& MyCullingRect,
+		FSlateWindowElementList& OutDrawElements, int32 LayerId, const FWidgetStyle& InWidgetStyle, bool bParentEnabled) const override;
+	virtual FVector2D ComputeDesiredSize(float LayoutScaleMultiplier) const override;
+
+private:
+	TSharedPtr<const FBTreeColumnLayout> Layout;
+	const FTextBlockStyle* TextStyle;
+	FMargin CellPadding;
+
+	/** Text of each column, copied from the node store as the draw elements take strings */
+	TArray<FString> CellTexts;
+};
@@ -0,0 +1,105 @@
+/// MIT License, Copyright Burak Kara, burak@burak.io, https://en.wikipedia.org/wiki/MIT_License
+
+#pragma once
+
+#include "BCustomTreeNode.h"
+#include "SlateCore.h"
+#include "SlateBasics.h"
+
+typedef STreeView<TreeNodePtr> STView;
+
+/** Nodes that joined and left the selection of a SBTreeView since it was last reported, by node index */
+struct FBSelectionDelta
+{
+	TArray<int32> SelectedNodes;
+	TArray<int32> DeselectedNodes;
+
+	/** How the last of the changes was made */
+	ESelectInfo::Type SelectInfo;
+};
+
+/**
+* Tree view whose selection is a bitset over node indices instead of a set of item handles, so that selecting tens
+* of thousands of nodes costs a bit each and selecting all of them a word per 32 nodes. Nodes stay selected while a
+* collapsed ancestor hides them.
+* Selection changes are collected during the frame and reported once, on the next tick, as a delta.
+*/
+class SBTreeView : public STView
+{
+
+public:
+	DECLARE_DELEGATE_OneParam(FOnSelectionDelta, const FBSelectionDelta&);
+
+	void Construct(const FArguments& InArgs, const FOnSelectionDelta& InOnSelectionDelta);
+
+	bool IsNodeSelected(int32 NodeIndex) const
+	{
+		return SelectedNodes.IsValidIndex(NodeIndex) && SelectedNodes[NodeIndex];
+	}
+
+	/** Selects or deselects nodes. Only the last node is selected unless the selection mode is Multi. */
+	void SetNodesSelection(const TArray<int32>& NodeIndices, bool bSelected);
+
+	/**
+	* Adds the nodes set in Nodes, and in Mask if given, to the selection a word at a time.
+	* Does nothing unless the selection mode is Multi.
+	*/
+	void SelectNodes(const TBitArray<>& Nodes, const TBitArray<>* Mask = nullptr);
+
+	void ClearNodeSelection();
+
+	/** @return Whether each node is selected, by node index */
+	const TBitArray<>& GetSelectedNodes() const
+	{
+		return SelectedNodes;
+	}
+
+	int32 GetNumSelectedNodes() const
+	{
+		return NumSelectedNodes;
+	}
+
+	/** @return The selected node with the lowest index, INDEX_NONE if there is none */
+	int32 GetFirstSelectedNode() const;
+
+	/** Drops removed nodes from the selection without reporting them */
+	void ForgetNodes(const TArray<int32>& NodeIndices);
+
+	/** Drops the whole selection without reporting it, after the node store was rebuilt */
+	void ResetSelection();
+
+	/** Takes the current selection as reported, the changes made so far are left out of the next delta */
+	void MarkSelectionReported();
+
+	/** ITypedTableView interface, the table rows select through these */
+	virtual bool Private_IsItemSelected(const TreeNodePtr& TheItem) const override;
+	virtual void Private_SetItemSelection(TreeNodePtr TheItem, bool bShouldBeSelected, bool bWasUserDirected = false) override;
+	virtual void Private_ClearSelection() override;
+	virtual void Private_SelectRangeFromCurrentTo(TreeNodePtr InRangeSelectionEnd) override;
+	virtual int32 Private_GetNumSelectedItems() const override;
+	virtual void Private_SignalSelectionChanged(ESelectInfo::Type SelectInfo) override;
+
+	/** SWidget overrides */
+	virtual void Tick(const FGeometry& AllottedGeometry, const double InCurrentTime, const float InDeltaTime) override;
+
+protected:
+	virtual void NavigationSelect(const TreeNodePtr& InItemToSelect, const FInputEvent& InInputEvent) override;
+
+private:
+	/** Selects or deselects a node, keeping NumSelectedNodes */
+	void SetNodeBit(int32 NodeIndex, bool bSelected);
+
+	/** Compares the selection with the reported one and calls OnSelectionDelta with the difference */
+	void ReportSelection();
+
+	TBitArray<> SelectedNodes;
+	int32 NumSelectedNodes;
+
+	/** SelectedNodes as it was last reported */
+	TBitArray<> ReportedNodes;
+
+	bool bSelectionChanged;
+	ESelectInfo::Type LastSelectInfo;
+
+	FOnSelectionDelta OnSelectionDelta;
+};